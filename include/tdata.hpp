@@ -2,15 +2,31 @@
 #define __TDATA_HPP__
 
 #include "variant.hpp"
+#include "tdata_charconv.hpp"
+#include "tdata_scan.hpp"
+#include "tdata_equal.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <cmath>
 #include <cassert>
 #include <limits>
+#include <new>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <type_traits>
 
+// Words of inline payload in a TData, which is 8 + 8 * TDATA_INLINE_WORDS bytes. Numeric
+// vectors of up to TDATA_INLINE_WORDS elements and strings of up to 5 + 8 * TDATA_INLINE_WORDS
+// chars live inside the object instead of on the heap.
+#ifndef TDATA_INLINE_WORDS
+#define TDATA_INLINE_WORDS 2
+#endif
+
 
 namespace tdata {
     enum class Type : char
@@ -41,6 +57,176 @@ namespace tdata {
     static const str_t kFieldSepStr = ":";
     static const str_t kEndSepStr = "$";
 
+    // Non-owning view of a char range, used where a value can be read in place without a copy.
+    class StrView
+    {
+    public:
+        using value_type = char;
+        using size_type = std::size_t;
+        using const_iterator = const value_type*;
+
+        StrView() = default;
+        StrView(const value_type* p, size_type n) : data_(p), size_(n) {}
+        StrView(const str_t& s) : data_(s.data()), size_(s.size()) {}
+        StrView(const value_type* s) : data_(s), size_(std::strlen(s)) {}
+
+        const value_type* data() const { return data_; }
+        size_type size() const { return size_; }
+        bool empty() const { return 0 == size_; }
+        const_iterator begin() const { return data_; }
+        const_iterator end() const { return data_ + size_; }
+        value_type operator[](size_type i) const { return data_[i]; }
+
+        str_t str() const { return str_t(data_, size_); }
+        operator str_t() const { return str(); }
+
+        int compare(StrView o) const
+        {
+            const auto n = std::min(size_, o.size_);
+            const int r = 0 == n ? 0 : std::memcmp(data_, o.data_, n);
+            return 0 != r ? r : (size_ < o.size_ ? -1 : size_ > o.size_ ? 1 : 0);
+        }
+
+    private:
+        const value_type* data_ = nullptr;
+        size_type size_ = 0;
+    };
+
+    inline bool operator== (StrView lhs, StrView rhs) { return lhs.size() == rhs.size() && 0 == lhs.compare(rhs); }
+    inline bool operator!= (StrView lhs, StrView rhs) { return !(lhs == rhs); }
+    inline bool operator< (StrView lhs, StrView rhs) { return lhs.compare(rhs) < 0; }
+    inline std::ostream& operator<< (std::ostream& os, StrView v) { return os.write(v.data(), v.size()); }
+
+    // Non-owning view of n contiguous T, e.g. the elements of a vector held in someone else's buffer.
+    template <typename T>
+    class Span
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using const_iterator = const value_type*;
+
+        Span() = default;
+        Span(const value_type* p, size_type n) : data_(p), size_(n) {}
+        Span(const std::vector<value_type>& v) : data_(v.data()), size_(v.size()) {}
+
+        const value_type* data() const { return data_; }
+        size_type size() const { return size_; }
+        bool empty() const { return 0 == size_; }
+        const_iterator begin() const { return data_; }
+        const_iterator end() const { return data_ + size_; }
+        const value_type& operator[](size_type i) const { return data_[i]; }
+
+        std::vector<value_type> vec() const { return std::vector<value_type>(begin(), end()); }
+        // Copies out to a std::vector of T, or to vstr_t from a Span<StrView>.
+        template <typename U, typename = typename std::enable_if<std::is_same<U, T>::value
+            || (std::is_same<T, StrView>::value && std::is_same<U, str_t>::value)>::type>
+        operator std::vector<U>() const { return std::vector<U>(begin(), end()); }
+
+    private:
+        const value_type* data_ = nullptr;
+        size_type size_ = 0;
+    };
+
+    // Raw growable byte sink. Like str_t it can be handed to every ToStr as the output buffer,
+    // but it never zero-fills on growth and clear() keeps the capacity for the next message.
+    class ByteBuffer
+    {
+    public:
+        using value_type = char;
+        using size_type = std::size_t;
+
+        ByteBuffer() = default;
+        explicit ByteBuffer(size_type capacity) { reserve(capacity); }
+        ByteBuffer(const ByteBuffer& o) { append(o.data(), o.size()); }
+        ByteBuffer(ByteBuffer&& o) noexcept : data_(o.data_), size_(o.size_), capacity_(o.capacity_)
+        {
+            o.data_ = nullptr;
+            o.size_ = o.capacity_ = 0;
+        }
+        ByteBuffer& operator= (const ByteBuffer& o)
+        {
+            if (this != &o)
+            {
+                clear();
+                append(o.data(), o.size());
+            }
+            return *this;
+        }
+        ByteBuffer& operator= (ByteBuffer&& o) noexcept
+        {
+            if (this != &o)
+            {
+                std::free(data_);
+                data_ = o.data_;
+                size_ = o.size_;
+                capacity_ = o.capacity_;
+                o.data_ = nullptr;
+                o.size_ = o.capacity_ = 0;
+            }
+            return *this;
+        }
+        ~ByteBuffer() { std::free(data_); }
+
+        const value_type* data() const { return data_; }
+        value_type* data() { return data_; }
+        size_type size() const { return size_; }
+        size_type capacity() const { return capacity_; }
+        bool empty() const { return 0 == size_; }
+        void clear() { size_ = 0; }
+        const value_type& operator[](size_type i) const { return data_[i]; }
+        value_type& operator[](size_type i) { return data_[i]; }
+
+        void reserve(size_type n)
+        {
+            if (n <= capacity_)
+            {
+                return;
+            }
+            auto p = static_cast<value_type*>(std::realloc(data_, n));
+            if (nullptr == p)
+            {
+                throw std::bad_alloc();
+            }
+            data_ = p;
+            capacity_ = n;
+        }
+
+        // Grows the buffer by n uninitialized bytes and returns a pointer to them.
+        value_type* extend(size_type n)
+        {
+            if (size_ + n > capacity_)
+            {
+                reserve(std::max(size_ + n, capacity_ * 2));
+            }
+            auto p = data_ + size_;
+            size_ += n;
+            return p;
+        }
+        void resize(size_type n)
+        {
+            reserve(n);
+            size_ = n;
+        }
+
+        void push_back(value_type c) { *extend(1) = c; }
+        void append(const value_type* p, size_type n)
+        {
+            if (0 != n)
+            {
+                std::memcpy(extend(n), p, n);
+            }
+        }
+        void append(size_type n, value_type c) { std::memset(extend(n), c, n); }
+
+        str_t str() const { return str_t(data_, size_); }
+
+    private:
+        value_type* data_ = nullptr;
+        size_type size_ = 0;
+        size_type capacity_ = 0;
+    };
+
     namespace detail {
         struct equal_comp
         {
@@ -54,64 +240,142 @@ namespace tdata {
             {
                 return fabs(lhs - rhs) < std::numeric_limits<real_t>::epsilon();
             }
-            bool operator()(const vreal_t& lhs, const vreal_t& rhs) const
+            bool operator()(Span<real_t> lhs, Span<real_t> rhs) const
             {
-                if (lhs.size() != rhs.size())
-                {
-                    return false;
-                }
-                return std::equal(lhs.begin(), lhs.end(), rhs.begin(), *this);
+                return lhs.size() == rhs.size() && Mismatch(lhs, rhs, Tolerance()) == lhs.size();
             }
-            bool operator()(const vint_t& lhs, const vint_t& rhs) const
+            bool operator()(Span<int_t> lhs, Span<int_t> rhs) const
             {
-                if (lhs.size() != rhs.size())
-                {
-                    return false;
-                }
-                return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+                return lhs.size() == rhs.size() && Mismatch(lhs, rhs) == lhs.size();
+            }
+            bool operator()(Span<StrView> lhs, Span<StrView> rhs) const
+            {
+                return lhs.size() == rhs.size() && Mismatch(lhs, rhs) == lhs.size();
+            }
+
+            // Index of the first pair of elements that differ within the shorter length, or that
+            // length.
+            static std::size_t Mismatch(Span<int_t> lhs, Span<int_t> rhs)
+            {
+                return Mismatcher::Ints(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+            }
+            static std::size_t Mismatch(Span<real_t> lhs, Span<real_t> rhs, const Tolerance& tol)
+            {
+                return Mismatcher::Reals(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()), tol);
             }
-            bool operator()(const vstr_t& lhs, const vstr_t& rhs) const
+            // Lengths first, bytes only when they agree and the views are not the same chars.
+            static std::size_t Mismatch(Span<StrView> lhs, Span<StrView> rhs)
             {
-                if (lhs.size() != rhs.size())
+                const auto n = std::min(lhs.size(), rhs.size());
+                for (std::size_t i = 0; i < n; ++i)
                 {
-                    return false;
+                    const auto& a = lhs[i];
+                    const auto& b = rhs[i];
+                    if (a.size() != b.size() || (0 != a.size() && a.data() != b.data() && 0 != std::memcmp(a.data(), b.data(), a.size())))
+                    {
+                        return i;
+                    }
                 }
-                return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+                return n;
             }
         };
 
         struct StrCoder
         {
+            static bool IsSpecial(str_t::value_type c) { return c == kFieldSepChar || c == kEndSepChar || c == kTransChar; }
+
             static str_t Encode(const str_t& s)
             {
                 str_t r;
                 r.reserve(s.size());
-                for (const auto c : s)
+                Encode(s, r);
+                return r;
+            }
+
+            // Appends the escaped form of s to the sink r: ':', '$' and the escape char itself
+            // are prefixed with kTransChar, so every unescaped ':' or '$' in the output is a
+            // delimiter. Runs between special chars are found with a SIMD scan and copied with
+            // one append each; a string without any is a single append. Escaping the escape
+            // char is a wire change from the original format, whose decoders read a '\' written
+            // here as two; strings without one encode as they always did.
+            template <typename S>
+            static void Encode(StrView s, S& r)
+            {
+                auto b = s.data();
+                const auto e = b + s.size();
+                for (auto p = FindSpecial(b, e); p < e; p = FindSpecial(p + 1, e))
                 {
-                    if (c == kFieldSepChar || c == kEndSepChar)
-                    {
-                        r.push_back(kTransChar);
-                    }
-                    r.push_back(c);
+                    r.append(b, p - b);
+                    r.push_back(kTransChar);
+                    b = p;
                 }
-                return std::move(r);
+                r.append(b, e - b);
             }
-            
+
+            // Unescapes [b, e). An escape char before anything but a special char is kept as is,
+            // which is how text written before the escape char itself was escaped reads back.
             static str_t Decode(const str_t::value_type* b, const str_t::value_type* e)
             {
+                if (FindEscape(b, e) == e)
+                {
+                    return str_t(b, e);
+                }
                 str_t r;
                 r.reserve(e - b);
-                for (; b < e; ++b)
+                Decode(b, e, r);
+                return r;
+            }
+
+            // Appends the unescaped [b, e) to the sink r, one append per run between escapes.
+            template <typename S>
+            static void Decode(const str_t::value_type* b, const str_t::value_type* e, S& r)
+            {
+                for (auto p = FindEscape(b, e); p < e; p = FindEscape(std::min(p + 2, e), e))
+                {
+                    if (p + 1 < e && IsSpecial(*(p + 1)))
+                    {
+                        r.append(b, p - b);
+                        b = p + 1;
+                    }
+                }
+                r.append(b, e - b);
+            }
+
+            // Unescapes [b, e) into out, which has room for e - b chars, and returns the end of
+            // what it wrote.
+            static char* DecodeTo(const str_t::value_type* b, const str_t::value_type* e, char* out)
+            {
+                for (auto p = FindEscape(b, e); p < e; p = FindEscape(std::min(p + 2, e), e))
                 {
-                    const auto cur = *b;
-                    const auto nex = *(b + 1);
-                    if (cur == kTransChar && (nex == kFieldSepChar || nex == kEndSepChar))
+                    if (p + 1 < e && IsSpecial(*(p + 1)))
                     {
-                        continue;
+                        std::memcpy(out, b, p - b);
+                        out += p - b;
+                        b = p + 1;
                     }
-                    r.push_back(cur);
                 }
-                return std::move(r);
+                if (b < e)
+                {
+                    std::memcpy(out, b, e - b);
+                    out += e - b;
+                }
+                return out;
+            }
+
+            static const str_t::value_type* FindSpecial(const str_t::value_type* b, const str_t::value_type* e)
+            {
+                return Scanner::FindFirstOf(b, e, kFieldSepChar, kEndSepChar, kTransChar);
+            }
+
+            static const str_t::value_type* FindEscape(const str_t::value_type* b, const str_t::value_type* e)
+            {
+                return Scanner::FindFirstOf(b, e, kTransChar, kTransChar, kTransChar);
+            }
+
+            // First unescaped c in [b, e), or e.
+            static const str_t::value_type* Find(const str_t::value_type* b, const str_t::value_type* e, str_t::value_type c)
+            {
+                return Scanner::FindUnescaped(b, e, c, kTransChar);
             }
 
             static Type GetType(const str_t& s, str_t::size_type beg)
@@ -120,376 +384,2250 @@ namespace tdata {
                 return beg + 1 >= size ? Type::kUnknown : static_cast<Type>(s[++beg]);
             }
 
-            static bool CheckTypeAndFindEnd(const str_t& s, Type type, str_t::size_type& beg, str_t::size_type& end)
+            static Type GetType(const str_t::value_type* first, const str_t::value_type* last)
             {
-                const auto size = s.size();
-                if (beg + 1 >= size || s[beg] != kBegSepChar || static_cast<Type>(s[++beg]) != type)
+                return last - first < 2 ? Type::kUnknown : static_cast<Type>(first[1]);
+            }
+
+            // Whether c is the tag of one of the six value types.
+            static bool IsType(str_t::value_type c)
+            {
+                switch (static_cast<Type>(c))
                 {
+                case Type::kInt:
+                case Type::kReal:
+                case Type::kStr:
+                case Type::kVInt:
+                case Type::kVReal:
+                case Type::kVStr:
+                    return true;
+                default:
                     return false;
                 }
-                end = ++beg;
-                while (++end < size && (s[end] != kEndSepChar || s[end - 1] == kTransChar))
+            }
+
+            static bool CheckTypeAndFindEnd(const str_t& s, Type type, str_t::size_type& beg, str_t::size_type& end)
+            {
+                const auto e = CheckTypeAndFindEnd(s.data() + beg, s.data() + s.size(), type);
+                if (nullptr == e)
                 {
+                    return false;
                 }
-                return end != size;
+                beg += 2;
+                end = e - s.data();
+                return true;
             }
-        };
-    }
-
-    template <typename T, typename = void>
-    struct tdata_traits : std::false_type {};
-
-    template <typename T>
-    struct tdata_traits<T, typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value>::type> : std::true_type
-    {
-        using value_type = int_t;
-        using return_type = int_t;
-        static constexpr auto enum_value = Type::kInt;
-        static const value_type null_value;
 
-        static void ToStr(return_type v, str_t& s) { s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + std::to_string(v) + kEndSepStr; }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
-        {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+            // Returns the '$' closing the record of the given type that starts at first, or nullptr
+            // when [first, last) does not start with one.
+            static const str_t::value_type* CheckTypeAndFindEnd(const str_t::value_type* first, const str_t::value_type* last, Type type)
             {
-                return false;
+                if (last - first < 2 || *first != kBegSepChar || static_cast<Type>(first[1]) != type)
+                {
+                    return nullptr;
+                }
+                const auto end = Find(first + 2, last, kEndSepChar);
+                return end != last ? end : nullptr;
             }
-            v = std::strtoll(&s[beg], nullptr, 10);
-            if (nullptr != p)
+
+            // Checks the header of a text vector record of the given type, reading its element
+            // count into n and leaving p on the first ':'. Every element takes at least width
+            // bytes with its ':', so a negative count or one the record cannot hold is rejected
+            // before anything is reserved. Returns the closing '$', or nullptr.
+            static const str_t::value_type* CheckTypeAndReadCount(const str_t::value_type* first, const str_t::value_type* last, Type type,
+                                                                 std::size_t width, std::size_t& n, const str_t::value_type*& p)
             {
-                *p = ++end;
+                const auto end = CheckTypeAndFindEnd(first, last, type);
+                return nullptr != end && ReadCount(first, end, width, n, p) ? end : nullptr;
             }
-            return true;
-        }
-    };
-    template <typename T>
-    const int_t tdata_traits<T, typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value>::type>::null_value = value_type();
-
-    template <typename T>
-    struct tdata_traits<T, typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value>::type> : std::true_type
-    {
-        using value_type = real_t;
-        using return_type = real_t;
-        static constexpr auto enum_value = Type::kReal;
-        static const value_type null_value;
 
-        static void ToStr(return_type v, str_t& s) { s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + std::to_string(v) + kEndSepStr; }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
-        {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+            // As above for a vector record [first, end] whose type and closing '$' are known.
+            static bool ReadCount(const str_t::value_type* first, const str_t::value_type* end, std::size_t width, std::size_t& n,
+                                  const str_t::value_type*& p)
             {
-                return false;
+                int_t size = 0;
+                p = IntParser::FromChars(first + 2, end, size);
+                if (size < 0 || static_cast<std::size_t>(size) > static_cast<std::size_t>(end - p) / width)
+                {
+                    return false;
+                }
+                n = static_cast<std::size_t>(size);
+                return true;
             }
-            v = std::strtod(&s[beg], nullptr);
-            if (nullptr != p)
+
+            // Reads the payload [first, end) of a kInt or kReal record, which must be one number
+            // and nothing else.
+            template <typename Parser, typename N>
+            static bool ReadNumber(const str_t::value_type* first, const str_t::value_type* end, N& v)
             {
-                *p = ++end;
+                const auto p = Parser::FromChars(first, end, v);
+                return p == end && p != first;
             }
-            return true;
-        }
-    };
-    template <typename T>
-    const real_t tdata_traits<T, typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value>::type>::null_value = value_type();
 
-    template <typename T>
-    struct tdata_traits<T, typename std::enable_if<
-        std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, str_t>::value
-        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, char*>::value
-        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, const char*>::value
-    >::type> : std::true_type
-    {
-        using value_type = str_t;
-        using return_type = const str_t&;
-        static constexpr auto enum_value = Type::kStr;
-        static const value_type null_value;
+            // The str_t flavour of every FromStr: decodes the record at s[*p] (or s[0]) with
+            // T::FromChars, handing it any extra arguments, and moves *p past it.
+            template <typename T, typename V, typename... A>
+            static bool FromStr(V& v, const str_t& s, str_t::size_type* p, A... a)
+            {
+                const auto beg = nullptr != p ? *p : 0;
+                if (beg > s.size())
+                {
+                    return false;
+                }
+                const auto end = T::FromChars(v, s.data() + beg, s.data() + s.size(), a...);
+                if (nullptr == end)
+                {
+                    return false;
+                }
+                if (nullptr != p)
+                {
+                    *p = end - s.data();
+                }
+                return true;
+            }
+        };
 
-        static void ToStr(return_type v, str_t& s) { s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + detail::StrCoder::Encode(v) + kEndSepStr; }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        // Number and header writers shared by every tdata_traits<T>::ToStr. They format into a
+        // stack buffer and append it to the sink in one call, so no temporary strings are built.
+        struct NumCoder
         {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+            static constexpr std::size_t kMaxIntLen = 20;
+
+            template <typename S>
+            static void AppendBeg(S& s, Type type)
             {
-                return false;
+                const str_t::value_type h[2] = { kBegSepChar, static_cast<str_t::value_type>(type) };
+                s.append(h, 2);
             }
-            v = detail::StrCoder::Decode(&s[beg], &s[end]);
-            if (nullptr != p)
+
+            template <typename S>
+            static void AppendUInt(S& s, uint64_t v)
             {
-                *p = ++end;
+                char buf[kMaxIntLen];
+                auto p = buf + kMaxIntLen;
+                do
+                {
+                    *--p = static_cast<char>('0' + v % 10);
+                    v /= 10;
+                } while (0 != v);
+                s.append(p, buf + kMaxIntLen - p);
             }
-            return true;
-        }
-    };
-    template <typename T>
-    const str_t tdata_traits<T, typename std::enable_if<
-        std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, str_t>::value
-        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, char*>::value
-        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, const char*>::value
-    >::type>::null_value = value_type();
 
-    template <typename T>
-    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vint_t>::value>::type> : std::true_type
-    {
-        using value_type = vint_t;
-        using return_type = const vint_t&;
-        static constexpr auto enum_value = Type::kVInt;
-        static const value_type null_value;
+            template <typename S>
+            static void AppendInt(S& s, int_t v)
+            {
+                if (v < 0)
+                {
+                    s.push_back('-');
+                    AppendUInt(s, 0 - static_cast<uint64_t>(v));
+                }
+                else
+                {
+                    AppendUInt(s, static_cast<uint64_t>(v));
+                }
+            }
 
-        static void ToStr(return_type v, str_t& s)
-        {
-            s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + std::to_string(v.size());
-            for (const auto n : v)
+            // Round-trip, near-shortest text for v, e.g. "0.1" or "3.2e-6"; it reads back to exactly v
+            // but may carry one digit more than the shortest such text.
+            template <typename S>
+            static void AppendReal(S& s, real_t v)
             {
-                s += kFieldSepStr + std::to_string(n);
+                char buf[Grisu2::kMaxLen];
+                s.append(buf, Grisu2::ToChars(buf, v) - buf);
             }
-            s += kEndSepStr;
-        }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        };
+
+        // The binary wire format: a record is the Type char followed by the payload. Integers
+        // are zigzag LEB128 varints, reals 8 little-endian bytes, strings a varint length and
+        // the raw bytes, vectors a varint count and the elements. Nothing is escaped.
+        struct BinCoder
         {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+            static constexpr std::size_t kMaxVarLen = 10;
+
+            template <typename S>
+            static void AppendUInt(S& s, uint64_t v)
             {
-                return false;
+                char buf[kMaxVarLen];
+                std::size_t n = 0;
+                for (; v >= 0x80; v >>= 7)
+                {
+                    buf[n++] = static_cast<char>(v | 0x80);
+                }
+                buf[n++] = static_cast<char>(v);
+                s.append(buf, n);
             }
-            str_t::value_type* begptr = nullptr;
-            const auto endptr = &s[end];
-            auto size = std::strtoll(&s[beg], &begptr, 10);
-            v.reserve(v.size() + static_cast<typename value_type::size_type>(size));
-            while (0 != size--)
+
+            template <typename S>
+            static void AppendInt(S& s, int_t v)
             {
-                assert(begptr < endptr);
-                v.push_back(std::strtoll(++begptr, &begptr, 10));
+                AppendUInt(s, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
             }
-            if (nullptr != p)
+
+            template <typename S>
+            static void AppendReal(S& s, real_t v)
             {
-                *p = ++end;
+                const auto u = ToLittle(Bits(v));
+                s.append(reinterpret_cast<const char*>(&u), sizeof(u));
             }
-            return true;
-        }
-    };
-    template <typename T>
-    const vint_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vint_t>::value>::type>::null_value = value_type();
-
-    template <typename T>
-    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vreal_t>::value>::type> : std::true_type
-    {
-        using value_type = vreal_t;
-        using return_type = const vreal_t&;
-        static constexpr auto enum_value = Type::kVReal;
-        static const value_type null_value;
 
-        static void ToStr(return_type v, str_t& s)
-        {
-            s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + std::to_string(v.size());
-            for (const auto n : v)
+            template <typename S>
+            static void AppendStr(S& s, StrView v)
             {
-                s += kFieldSepStr + std::to_string(n);
+                AppendUInt(s, v.size());
+                s.append(v.data(), v.size());
             }
-            s += kEndSepStr;
-        }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
-        {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+
+            // The read functions return the end of what they consumed, or nullptr when the bytes
+            // run out or a varint is longer than 64 bits.
+            static const char* ReadUInt(const char* p, const char* last, uint64_t& v)
             {
-                return false;
+                v = 0;
+                for (int shift = 0; p < last && shift < 64; shift += 7)
+                {
+                    const auto b = static_cast<unsigned char>(*p++);
+                    if (63 == shift && b > 1)
+                    {
+                        return nullptr;
+                    }
+                    v |= static_cast<uint64_t>(b & 0x7f) << shift;
+                    if (b < 0x80)
+                    {
+                        return p;
+                    }
+                }
+                return nullptr;
             }
-            str_t::value_type* begptr = nullptr;
-            const auto endptr = &s[end];
-            auto size = std::strtoll(&s[beg], &begptr, 10);
-            v.reserve(v.size() + static_cast<typename value_type::size_type>(size));
-            while (0 != size--)
+
+            static const char* ReadInt(const char* p, const char* last, int_t& v)
             {
-                assert(begptr < endptr);
-                v.push_back(std::strtod(++begptr, &begptr));
+                uint64_t u = 0;
+                p = ReadUInt(p, last, u);
+                v = static_cast<int_t>((u >> 1) ^ (0 - (u & 1)));
+                return p;
             }
-            if (nullptr != p)
+
+            static const char* ReadReal(const char* p, const char* last, real_t& v)
             {
-                *p = ++end;
+                if (last - p < static_cast<std::ptrdiff_t>(sizeof(real_t)))
+                {
+                    return nullptr;
+                }
+                uint64_t u = 0;
+                std::memcpy(&u, p, sizeof(u));
+                u = ToLittle(u);
+                std::memcpy(&v, &u, sizeof(v));
+                return p + sizeof(u);
             }
-            return true;
-        }
-    };
-    template <typename T>
-    const vreal_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vreal_t>::value>::type>::null_value = value_type();
+
+            static const char* ReadStr(const char* p, const char* last, str_t& v)
+            {
+                const char* b = nullptr;
+                std::size_t n = 0;
+                p = ReadLen(p, last, 1, b, n);
+                if (nullptr != p)
+                {
+                    v.assign(b, n);
+                }
+                return p;
+            }
+
+            // Reads a varint length of n elements of width bytes each and checks that they fit
+            // in [p, last); b is set to the first element.
+            static const char* ReadLen(const char* p, const char* last, std::size_t width, const char*& b, std::size_t& n)
+            {
+                uint64_t u = 0;
+                p = ReadUInt(p, last, u);
+                if (nullptr == p || u > static_cast<uint64_t>(last - p) / width)
+                {
+                    return nullptr;
+                }
+                b = p;
+                n = static_cast<std::size_t>(u);
+                return p + n * width;
+            }
+
+            // Checks the tag of the record at first and returns its payload, or nullptr.
+            static const char* CheckType(const char* first, const char* last, Type type)
+            {
+                return first < last && *first == static_cast<char>(type) ? first + 1 : nullptr;
+            }
+
+            static uint64_t Bits(real_t v)
+            {
+                uint64_t u;
+                std::memcpy(&u, &v, sizeof(u));
+                return u;
+            }
+
+            static uint64_t ToLittle(uint64_t u)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return __builtin_bswap64(u);
+#else
+                return u;
+#endif
+            }
+
+            // The str_t flavour of every FromBinary, the counterpart of StrCoder::FromStr.
+            template <typename T, typename V, typename... A>
+            static bool FromBinary(V& v, const str_t& s, str_t::size_type* p, A... a)
+            {
+                const auto beg = nullptr != p ? *p : 0;
+                if (beg > s.size())
+                {
+                    return false;
+                }
+                const auto end = T::FromBinary(v, s.data() + beg, s.data() + s.size(), a...);
+                if (nullptr == end)
+                {
+                    return false;
+                }
+                if (nullptr != p)
+                {
+                    *p = end - s.data();
+                }
+                return true;
+            }
+        };
+    }
+
+    template <typename T, typename = void>
+    struct tdata_traits : std::false_type {};
+
+    template <typename T>
+    struct tdata_traits<T, typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value>::type> : std::true_type
+    {
+        using value_type = int_t;
+        using return_type = int_t;
+        static constexpr auto enum_value = Type::kInt;
+        static const value_type null_value;
+
+        template <typename S>
+        static void ToStr(return_type v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::NumCoder::AppendInt(s, v);
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        // Decodes the record that starts at first and returns its end, or nullptr when
+        // [first, last) does not start with a well-formed record of this type.
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            const auto end = detail::StrCoder::CheckTypeAndFindEnd(first, last, enum_value);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            return detail::StrCoder::ReadNumber<detail::IntParser>(first + 2, end, v) ? end + 1 : nullptr;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendInt(s, v);
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        // Decodes the binary record that starts at first and returns its end, or nullptr.
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            const auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            return nullptr != p ? detail::BinCoder::ReadInt(p, last, v) : nullptr;
+        }
+    };
+    template <typename T>
+    const int_t tdata_traits<T, typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value>::type>::null_value = value_type();
+
+    template <typename T>
+    struct tdata_traits<T, typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value>::type> : std::true_type
+    {
+        using value_type = real_t;
+        using return_type = real_t;
+        static constexpr auto enum_value = Type::kReal;
+        static const value_type null_value;
+
+        template <typename S>
+        static void ToStr(return_type v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::NumCoder::AppendReal(s, v);
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            const auto end = detail::StrCoder::CheckTypeAndFindEnd(first, last, enum_value);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            return detail::StrCoder::ReadNumber<detail::FloatParser>(first + 2, end, v) ? end + 1 : nullptr;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendReal(s, v);
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            const auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            return nullptr != p ? detail::BinCoder::ReadReal(p, last, v) : nullptr;
+        }
+    };
+    template <typename T>
+    const real_t tdata_traits<T, typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value>::type>::null_value = value_type();
+
+    template <typename T>
+    struct tdata_traits<T, typename std::enable_if<
+        std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, str_t>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, char*>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, const char*>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, StrView>::value
+    >::type> : std::true_type
+    {
+        using value_type = str_t;
+        using return_type = StrView;
+        static constexpr auto enum_value = Type::kStr;
+        static const value_type null_value;
+
+        template <typename S>
+        static void ToStr(return_type v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::StrCoder::Encode(v, s);
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            const auto end = detail::StrCoder::CheckTypeAndFindEnd(first, last, enum_value);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            // Decoded into v's own buffer, so a string read over and over keeps its capacity.
+            v.clear();
+            detail::StrCoder::Decode(first + 2, end, v);
+            return end + 1;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendStr(s, v);
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            const auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            return nullptr != p ? detail::BinCoder::ReadStr(p, last, v) : nullptr;
+        }
+    };
+    template <typename T>
+    const str_t tdata_traits<T, typename std::enable_if<
+        std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, str_t>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, char*>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, const char*>::value
+        || std::is_same<typename std::remove_cv<typename std::decay<T>::type>::type, StrView>::value
+    >::type>::null_value = value_type();
+
+    template <typename T>
+    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vint_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<int_t>>::value>::type> : std::true_type
+    {
+        using value_type = vint_t;
+        using return_type = Span<int_t>;
+        static constexpr auto enum_value = Type::kVInt;
+        static const value_type null_value;
+
+        template <typename S>
+        static void ToStr(return_type v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::NumCoder::AppendUInt(s, v.size());
+            for (const auto n : v)
+            {
+                s.push_back(kFieldSepChar);
+                detail::NumCoder::AppendInt(s, n);
+            }
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            std::size_t size = 0;
+            const char* begptr = nullptr;
+            const auto end = detail::StrCoder::CheckTypeAndReadCount(first, last, enum_value, 2, size, begptr);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            v.reserve(v.size() + size);
+            while (0 != size--)
+            {
+                if (begptr >= end || *begptr != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                int_t n = 0;
+                const auto next = detail::IntParser::FromChars(begptr + 1, end, n);
+                if (next == begptr + 1)
+                {
+                    return nullptr;
+                }
+                begptr = next;
+                v.push_back(n);
+            }
+            return begptr == end ? end + 1 : nullptr;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendUInt(s, v.size());
+            for (const auto n : v)
+            {
+                detail::BinCoder::AppendInt(s, n);
+            }
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            const char* b = nullptr;
+            std::size_t size = 0;
+            if (nullptr == p || nullptr == detail::BinCoder::ReadLen(p, last, 1, b, size))
+            {
+                return nullptr;
+            }
+            p = b;
+            v.reserve(v.size() + size);
+            while (0 != size--)
+            {
+                int_t n = 0;
+                if (nullptr == (p = detail::BinCoder::ReadInt(p, last, n)))
+                {
+                    return nullptr;
+                }
+                v.push_back(n);
+            }
+            return p;
+        }
+    };
+    template <typename T>
+    const vint_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vint_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<int_t>>::value>::type>::null_value = value_type();
+
+    template <typename T>
+    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vreal_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<real_t>>::value>::type> : std::true_type
+    {
+        using value_type = vreal_t;
+        using return_type = Span<real_t>;
+        static constexpr auto enum_value = Type::kVReal;
+        static const value_type null_value;
+
+        template <typename S>
+        static void ToStr(return_type v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::NumCoder::AppendUInt(s, v.size());
+            for (const auto n : v)
+            {
+                s.push_back(kFieldSepChar);
+                detail::NumCoder::AppendReal(s, n);
+            }
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            std::size_t size = 0;
+            const char* begptr = nullptr;
+            const auto end = detail::StrCoder::CheckTypeAndReadCount(first, last, enum_value, 2, size, begptr);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            v.reserve(v.size() + size);
+            while (0 != size--)
+            {
+                if (begptr >= end || *begptr != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                real_t n = 0;
+                const auto next = detail::FloatParser::FromChars(begptr + 1, end, n);
+                if (next == begptr + 1)
+                {
+                    return nullptr;
+                }
+                begptr = next;
+                v.push_back(n);
+            }
+            return begptr == end ? end + 1 : nullptr;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendUInt(s, v.size());
+            for (const auto n : v)
+            {
+                detail::BinCoder::AppendReal(s, n);
+            }
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            const char* b = nullptr;
+            std::size_t size = 0;
+            if (nullptr == p || nullptr == (p = detail::BinCoder::ReadLen(p, last, sizeof(real_t), b, size)))
+            {
+                return nullptr;
+            }
+            const auto old = v.size();
+            v.resize(old + size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                detail::BinCoder::ReadReal(b + i * sizeof(real_t), p, v[old + i]);
+            }
+            return p;
+        }
+    };
+    template <typename T>
+    const vreal_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vreal_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<real_t>>::value>::type>::null_value = value_type();
 
     template <typename T>
-    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vstr_t>::value>::type> : std::true_type
+    struct tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vstr_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<StrView>>::value>::type> : std::true_type
     {
         using value_type = vstr_t;
-        using return_type = const vstr_t&;
+        using return_type = Span<StrView>;
         static constexpr auto enum_value = Type::kVStr;
         static const value_type null_value;
 
-        static void ToStr(return_type v, str_t& s)
+        template <typename S>
+        static void ToStr(return_type v, S& s) { ToStrRange(v, s); }
+        template <typename S>
+        static void ToStr(const value_type& v, S& s) { ToStrRange(v, s); }
+        // v is a vstr_t or the Span<StrView> of a TData.
+        template <typename V, typename S>
+        static void ToStrRange(const V& v, S& s)
+        {
+            detail::NumCoder::AppendBeg(s, enum_value);
+            detail::NumCoder::AppendUInt(s, v.size());
+            for (const auto& n : v)
+            {
+                s.push_back(kFieldSepChar);
+                detail::StrCoder::Encode(n, s);
+            }
+            s.push_back(kEndSepChar);
+        }
+        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<tdata_traits>(v, s, p);
+        }
+        static const char* FromChars(value_type& v, const char* first, const char* last)
+        {
+            std::size_t size = 0;
+            const char* begptr = nullptr;
+            const auto end = detail::StrCoder::CheckTypeAndReadCount(first, last, enum_value, 1, size, begptr);
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+            v.reserve(v.size() + size);
+            while (0 != size--)
+            {
+                if (begptr >= end || *begptr != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                const auto ptr = detail::StrCoder::Find(++begptr, end, kFieldSepChar);
+                v.push_back(detail::StrCoder::Decode(begptr, ptr));
+                begptr = ptr;
+            }
+            return begptr == end ? end + 1 : nullptr;
+        }
+        template <typename S>
+        static void ToBinary(return_type v, S& s) { ToBinaryRange(v, s); }
+        template <typename S>
+        static void ToBinary(const value_type& v, S& s) { ToBinaryRange(v, s); }
+        template <typename V, typename S>
+        static void ToBinaryRange(const V& v, S& s)
+        {
+            s.push_back(static_cast<char>(enum_value));
+            detail::BinCoder::AppendUInt(s, v.size());
+            for (const auto& n : v)
+            {
+                detail::BinCoder::AppendStr(s, n);
+            }
+        }
+        static bool FromBinary(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<tdata_traits>(v, s, p);
+        }
+        static const char* FromBinary(value_type& v, const char* first, const char* last)
+        {
+            auto p = detail::BinCoder::CheckType(first, last, enum_value);
+            const char* b = nullptr;
+            std::size_t size = 0;
+            if (nullptr == p || nullptr == detail::BinCoder::ReadLen(p, last, 1, b, size))
+            {
+                return nullptr;
+            }
+            p = b;
+            v.reserve(v.size() + size);
+            while (0 != size--)
+            {
+                v.emplace_back();
+                if (nullptr == (p = detail::BinCoder::ReadStr(p, last, v.back())))
+                {
+                    return nullptr;
+                }
+            }
+            return p;
+        }
+    };
+    template <typename T>
+    const vstr_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vstr_t>::value
+        || std::is_same<typename std::decay<T>::type, Span<StrView>>::value>::type>::null_value = value_type();
+
+    // Where a TData takes the memory of strings and vectors too long to keep inline, in the
+    // manner of std::pmr::memory_resource. A null resource stands for the global heap. Allocate
+    // returns 8-byte aligned memory or throws std::bad_alloc.
+    class MemoryResource
+    {
+    public:
+        virtual ~MemoryResource() {}
+
+        virtual void* Allocate(std::size_t bytes) = 0;
+        virtual void Deallocate(void* p, std::size_t bytes) = 0;
+    };
+
+    namespace detail {
+        template <Type type>
+        using TypeTag = std::integral_constant<Type, type>;
+
+        // Out-of-line payload of a kStr or vector TData: the element count, the byte capacity
+        // and the resource it came from, then the elements, 8-byte aligned. A kVStr block holds
+        // one StrView per element followed by the chars they point into.
+        struct Block
+        {
+            std::size_t size;
+            std::size_t capacity;
+            MemoryResource* resource;
+
+            char* data() { return reinterpret_cast<char*>(this + 1); }
+            const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+
+            static Block* Allocate(std::size_t capacity, MemoryResource* resource)
+            {
+                const auto bytes = sizeof(Block) + capacity;
+                auto b = static_cast<Block*>(nullptr != resource ? resource->Allocate(bytes) : std::malloc(bytes));
+                if (nullptr == b)
+                {
+                    throw std::bad_alloc();
+                }
+                b->size = 0;
+                b->capacity = capacity;
+                b->resource = resource;
+                return b;
+            }
+
+            static void Free(Block* b)
+            {
+                if (nullptr != b && nullptr != b->resource)
+                {
+                    b->resource->Deallocate(b, sizeof(Block) + b->capacity);
+                }
+                else
+                {
+                    std::free(b);
+                }
+            }
+        };
+
+        // A fast, non-cryptographic 64-bit hash: 8-byte words folded in with a multiply and
+        // xor-shift mix. Not stable across builds or byte orders.
+        struct Hasher
+        {
+            static uint64_t Mix(uint64_t x)
+            {
+                x ^= x >> 32;
+                x *= 0xd6e8feb86659fd93ULL;
+                x ^= x >> 32;
+                return x;
+            }
+
+            static uint64_t Bytes(const char* p, std::size_t n)
+            {
+                const uint64_t k = 0x9e3779b97f4a7c15ULL;
+                uint64_t h = n * k;
+                if (n >= 32)
+                {
+                    h = Words(p, n / 8, h, RawWord());
+                    p += n & ~static_cast<std::size_t>(7);
+                    n &= 7;
+                }
+                for (; n >= 8; p += 8, n -= 8)
+                {
+                    uint64_t w;
+                    std::memcpy(&w, p, 8);
+                    h = (h ^ Mix(w)) * k;
+                }
+                if (0 != n)
+                {
+                    uint64_t w = 0;
+                    std::memcpy(&w, p, n);
+                    h = (h ^ Mix(w)) * k;
+                }
+                return Mix(h);
+            }
+
+            // One word into an accumulator: multiply, rotate, multiply.
+            static uint64_t Round(uint64_t acc, uint64_t w)
+            {
+                acc += w * 0xc2b2ae3d27d4eb4fULL;
+                acc = (acc << 31) | (acc >> 33);
+                return acc * 0x9e3779b185ebca87ULL;
+            }
+
+            // The bits of a real with -0 folded into 0 and every NaN into one, so that reals
+            // that ExactEqual calls equal hash alike.
+            static uint64_t RealBits(real_t v)
+            {
+                uint64_t w = 0x7ff8000000000000ULL;
+                if (v == v)
+                {
+                    v += 0.0;
+                    std::memcpy(&w, &v, 8);
+                }
+                return w;
+            }
+
+            struct RawWord
+            {
+                uint64_t operator()(const char* p) const
+                {
+                    uint64_t w;
+                    std::memcpy(&w, p, 8);
+                    return w;
+                }
+            };
+
+            struct RealWord
+            {
+                uint64_t operator()(const char* p) const
+                {
+                    real_t v;
+                    std::memcpy(&v, p, 8);
+                    return RealBits(v);
+                }
+            };
+
+            // Hashes n 8-byte words read by word. Four independent lanes take 32 bytes per step,
+            // so their multiplies overlap and long arrays hash at close to memory speed; SSE2 and
+            // AVX2 have no 64-bit multiply to do better.
+            template <typename W>
+            static uint64_t Words(const char* p, std::size_t n, uint64_t seed, W word)
+            {
+                uint64_t a = seed + 0x60ea27eeadc0b5d6ULL;
+                uint64_t b = seed + 0xc2b2ae3d27d4eb4fULL;
+                uint64_t c = seed;
+                uint64_t d = seed - 0x9e3779b185ebca87ULL;
+                for (; n >= 4; p += 32, n -= 4)
+                {
+                    a = Round(a, word(p));
+                    b = Round(b, word(p + 8));
+                    c = Round(c, word(p + 16));
+                    d = Round(d, word(p + 24));
+                }
+                uint64_t h = ((a << 1) | (a >> 63)) + ((b << 7) | (b >> 57)) + ((c << 12) | (c >> 52)) + ((d << 18) | (d >> 46));
+                for (; n > 0; p += 8, --n)
+                {
+                    h = Round(h, word(p));
+                }
+                return h;
+            }
+        };
+    }
+
+    // Keeps one shared, immutable copy of each distinct string for the TData values that intern
+    // through it; StrPool in tdata_intern.hpp is the thread-safe one. Intern returns a Block of
+    // s.size() chars whose resource is Resource(), which is how TData recognizes pooled strings;
+    // it must outlive the values that use it. An Interner is not itself a MemoryResource, so
+    // SetValue(v, &pool) does not compile instead of quietly skipping the pool.
+    class Interner
+    {
+    public:
+        virtual ~Interner() {}
+
+        virtual const detail::Block* Intern(StrView s) = 0;
+        virtual MemoryResource& Resource() = 0;
+    };
+
+    // One value of any of the six types in 8 + 8 * TDATA_INLINE_WORDS bytes (24 by default): the
+    // type tag, and words holding the number, a short string or numeric vector inline, or a
+    // pointer to the Block of a longer one. GetValue hands strings and vectors out as StrView /
+    // Span views of that storage, which convert to str_t and the std vectors on demand.
+    //
+    // Out-of-line payloads come from the heap, or from the MemoryResource given to SetValue or a
+    // decoder, and later assignments keep using the resource of the current block. A copy
+    // constructed TData is on the heap; a moved one takes the block, resource and all. The
+    // resource must outlive every TData that holds one of its blocks.
+    //
+    // Strings set or decoded through an Interner are shared instead: a kStr too long to keep
+    // inline points at the pooled copy, and the elements of a kVStr point into the pool, so
+    // copies are cheap and equal pooled strings compare by address.
+    class TData
+    {
+    public:
+        TData() { u_[0].i = 0; }
+        TData(const TData& o) : TData() { Copy(o); }
+        TData(TData&& o) noexcept { Steal(o); }
+        TData& operator= (const TData& o)
+        {
+            if (this != &o)
+            {
+                Copy(o);
+            }
+            return *this;
+        }
+        TData& operator= (TData&& o) noexcept
+        {
+            if (this != &o)
+            {
+                Release();
+                Steal(o);
+            }
+            return *this;
+        }
+        ~TData() { Release(); }
+
+        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
+        explicit TData(T&& v) : TData()
+        {
+            SetValue(std::forward<T>(v));
+        }
+
+        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
+        TData(T&& v, MemoryResource* resource) : TData()
+        {
+            SetValue(std::forward<T>(v), resource);
+        }
+
+        // Empties the value but keeps its type, and the capacity of a string or vector.
+        void Clear()
+        {
+            if (IsShared())
+            {
+                DropBlock();
+                u_[0].b = nullptr;
+            }
+            else if (HasBlock())
+            {
+                u_[0].b->size = 0;
+            }
+            else if (IsInline())
+            {
+                small_ = 0;
+            }
+            else
+            {
+                u_[0].i = 0;
+            }
+        }
+
+        bool IsNull() const
+        {
+            switch (GetType())
+            {
+            case Type::kInt: return tdata_traits<int_t>::null_value == GetValue<int_t>();
+            case Type::kReal: return tdata_traits<real_t>::null_value == GetValue<real_t>();
+            case Type::kStr: return GetValue<str_t>().empty();
+            case Type::kVInt: return GetValue<vint_t>().empty();
+            case Type::kVReal: return GetValue<vreal_t>().empty();
+            case Type::kVStr: return GetValue<vstr_t>().empty();
+            default: break;
+            }
+            return true;
+        }
+
+        str_t ToStr() const
+        {
+            str_t str;
+            ToStr(str);
+            return str;
+        }
+
+        // Appends the encoded value to s, which is a str_t, a ByteBuffer or any sink with
+        // push_back(char) and append(const char*, size_type).
+        template <typename S>
+        void ToStr(S& s) const
+        {
+            switch (GetType())
+            {
+            case Type::kInt: tdata_traits<int_t>::ToStr(GetValue<int_t>(), s); break;
+            case Type::kReal: tdata_traits<real_t>::ToStr(GetValue<real_t>(), s); break;
+            case Type::kStr: tdata_traits<str_t>::ToStr(GetValue<str_t>(), s); break;
+            case Type::kVInt: tdata_traits<vint_t>::ToStr(GetValue<vint_t>(), s); break;
+            case Type::kVReal: tdata_traits<vreal_t>::ToStr(GetValue<vreal_t>(), s); break;
+            case Type::kVStr: tdata_traits<vstr_t>::ToStr(GetValue<vstr_t>(), s); break;
+            default: break;
+            }
+        }
+
+        static bool FromStr(TData& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<TData>(v, s, p, v.GetResource());
+        }
+
+        static bool FromStr(TData& v, const str_t& s, str_t::size_type* p, MemoryResource* resource)
+        {
+            return detail::StrCoder::FromStr<TData>(v, s, p, resource);
+        }
+
+        // Decodes the record that starts at first and returns its end, or nullptr on failure.
+        static const char* FromChars(TData& v, const char* first, const char* last)
+        {
+            return FromChars(v, first, last, v.GetResource());
+        }
+
+        // As above, taking the payload of a string or vector from resource. Strings and vectors
+        // are decoded straight into v's storage, reusing its block when the type matches and the
+        // capacity suffices; if the record is bad, such a v is left empty.
+        static const char* FromChars(TData& v, const char* first, const char* last, MemoryResource* resource)
+        {
+            const char* end = nullptr;
+            switch (detail::StrCoder::GetType(first, last))
+            {
+            case Type::kInt: { int_t i; end = tdata_traits<int_t>::FromChars(i, first, last); return nullptr != end && v.SetValue(i) ? end : nullptr; }
+            case Type::kReal: { real_t r; end = tdata_traits<real_t>::FromChars(r, first, last); return nullptr != end && v.SetValue(r) ? end : nullptr; }
+            case Type::kStr: return v.DecodeInPlace<Type::kStr>(first, last, Form::kText, resource);
+            case Type::kVInt: return v.DecodeInPlace<Type::kVInt>(first, last, Form::kText, resource);
+            case Type::kVReal: return v.DecodeInPlace<Type::kVReal>(first, last, Form::kText, resource);
+            case Type::kVStr: return v.DecodeInPlace<Type::kVStr>(first, last, Form::kText, resource);
+            default: return nullptr;
+            }
+        }
+
+        // As above, keeping the strings of a kStr or kVStr in pool.
+        static const char* FromChars(TData& v, const char* first, const char* last, Interner& pool)
+        {
+            switch (detail::StrCoder::GetType(first, last))
+            {
+            case Type::kStr: return v.DecodeInPlace<Type::kStr>(first, last, Form::kText, v.GetResource(), &pool);
+            case Type::kVStr: return v.DecodeInPlace<Type::kVStr>(first, last, Form::kText, v.GetResource(), &pool);
+            default: return FromChars(v, first, last);
+            }
+        }
+
+        // Decodes the text record [first, end] whose closing '$' a scan has already found, e.g.
+        // with StrCoder::Find, without searching for it again. Returns end + 1, or nullptr when
+        // the record is malformed.
+        static const char* FromRecord(TData& v, const char* first, const char* end)
+        {
+            if (end - first < 2 || *first != kBegSepChar)
+            {
+                return nullptr;
+            }
+            switch (static_cast<Type>(first[1]))
+            {
+            case Type::kInt: { int_t i; return detail::StrCoder::ReadNumber<detail::IntParser>(first + 2, end, i) && v.SetValue(i) ? end + 1 : nullptr; }
+            case Type::kReal: { real_t r; return detail::StrCoder::ReadNumber<detail::FloatParser>(first + 2, end, r) && v.SetValue(r) ? end + 1 : nullptr; }
+            case Type::kStr: return v.DecodeInPlace<Type::kStr>(first, end + 1, Form::kRecord, v.GetResource());
+            case Type::kVInt: return v.DecodeInPlace<Type::kVInt>(first, end + 1, Form::kRecord, v.GetResource());
+            case Type::kVReal: return v.DecodeInPlace<Type::kVReal>(first, end + 1, Form::kRecord, v.GetResource());
+            case Type::kVStr: return v.DecodeInPlace<Type::kVStr>(first, end + 1, Form::kRecord, v.GetResource());
+            default: return nullptr;
+            }
+        }
+
+        str_t ToBinary() const
+        {
+            str_t str;
+            ToBinary(str);
+            return str;
+        }
+
+        // Appends the value in the binary wire format to s, any sink ToStr accepts.
+        template <typename S>
+        void ToBinary(S& s) const
+        {
+            switch (GetType())
+            {
+            case Type::kInt: tdata_traits<int_t>::ToBinary(GetValue<int_t>(), s); break;
+            case Type::kReal: tdata_traits<real_t>::ToBinary(GetValue<real_t>(), s); break;
+            case Type::kStr: tdata_traits<str_t>::ToBinary(GetValue<str_t>(), s); break;
+            case Type::kVInt: tdata_traits<vint_t>::ToBinary(GetValue<vint_t>(), s); break;
+            case Type::kVReal: tdata_traits<vreal_t>::ToBinary(GetValue<vreal_t>(), s); break;
+            case Type::kVStr: tdata_traits<vstr_t>::ToBinary(GetValue<vstr_t>(), s); break;
+            default: break;
+            }
+        }
+
+        static bool FromBinary(TData& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<TData>(v, s, p, v.GetResource());
+        }
+
+        static bool FromBinary(TData& v, const str_t& s, str_t::size_type* p, MemoryResource* resource)
+        {
+            return detail::BinCoder::FromBinary<TData>(v, s, p, resource);
+        }
+
+        // Decodes the binary record that starts at first and returns its end, or nullptr on failure.
+        static const char* FromBinary(TData& v, const char* first, const char* last)
+        {
+            return FromBinary(v, first, last, v.GetResource());
+        }
+
+        static const char* FromBinary(TData& v, const char* first, const char* last, MemoryResource* resource)
+        {
+            const char* end = nullptr;
+            switch (first < last ? static_cast<Type>(*first) : Type::kUnknown)
+            {
+            case Type::kInt: { int_t i; end = tdata_traits<int_t>::FromBinary(i, first, last); return nullptr != end && v.SetValue(i) ? end : nullptr; }
+            case Type::kReal: { real_t r; end = tdata_traits<real_t>::FromBinary(r, first, last); return nullptr != end && v.SetValue(r) ? end : nullptr; }
+            case Type::kStr: return v.DecodeInPlace<Type::kStr>(first, last, Form::kBinary, resource);
+            case Type::kVInt: return v.DecodeInPlace<Type::kVInt>(first, last, Form::kBinary, resource);
+            case Type::kVReal: return v.DecodeInPlace<Type::kVReal>(first, last, Form::kBinary, resource);
+            case Type::kVStr: return v.DecodeInPlace<Type::kVStr>(first, last, Form::kBinary, resource);
+            default: return nullptr;
+            }
+        }
+
+        static const char* FromBinary(TData& v, const char* first, const char* last, Interner& pool)
+        {
+            switch (first < last ? static_cast<Type>(*first) : Type::kUnknown)
+            {
+            case Type::kStr: return v.DecodeInPlace<Type::kStr>(first, last, Form::kBinary, v.GetResource(), &pool);
+            case Type::kVStr: return v.DecodeInPlace<Type::kVStr>(first, last, Form::kBinary, v.GetResource(), &pool);
+            default: return FromBinary(v, first, last);
+            }
+        }
+
+        // Decode a record that must be of the given type, skipping the switch on its tag; for
+        // decoders that know the type up front, such as TRecord. nullptr when the record is
+        // malformed or of another type, or when v holds another type.
+        template <Type type>
+        static const char* FromCharsAs(TData& v, const char* first, const char* last, MemoryResource* resource)
+        {
+            return v.DecodeAs(detail::TypeTag<type>(), first, last, Form::kText, resource);
+        }
+
+        template <Type type>
+        static const char* FromBinaryAs(TData& v, const char* first, const char* last, MemoryResource* resource)
+        {
+            return v.DecodeAs(detail::TypeTag<type>(), first, last, Form::kBinary, resource);
+        }
+
+        template <typename T>
+        bool SetValue(T&& v)
+        {
+            return SetValue(std::forward<T>(v), GetResource());
+        }
+
+        // Sets a string or vector of strings through pool, which shares one copy of each; kStr
+        // values short enough to keep inline stay inline.
+        template <typename T>
+        bool SetValue(T&& v, Interner& pool)
+        {
+            if (GetType() == Type::kUnknown)
+            {
+                SetType(tdata_traits<T>::enum_value);
+            }
+            if (GetType() == tdata_traits<T>::enum_value)
+            {
+                AssignInterned(std::forward<T>(v), detail::TypeTag<tdata_traits<T>::enum_value>(), pool);
+                return true;
+            }
+            return false;
+        }
+
+        // Sets the value, taking a string or vector payload that does not fit inline from
+        // resource (nullptr for the heap).
+        template <typename T>
+        bool SetValue(T&& v, MemoryResource* resource)
+        {
+            if (GetType() == Type::kUnknown)
+            {
+                SetType(tdata_traits<T>::enum_value);
+            }
+            if (GetType() == tdata_traits<T>::enum_value)
+            {
+                Assign(std::forward<T>(v), detail::TypeTag<tdata_traits<T>::enum_value>(), resource);
+                return true;
+            }
+            return false;
+        }
+
+        // The value as int_t, real_t, StrView, Span<int_t>, Span<real_t> or Span<StrView>; the
+        // views stay valid until the TData is changed or destroyed.
+        template <typename T>
+        typename tdata_traits<T>::return_type GetValue() const
+        {
+            if (GetType() == tdata_traits<T>::enum_value)
+            {
+                return Get(detail::TypeTag<tdata_traits<T>::enum_value>());
+            }
+            return typename tdata_traits<T>::return_type();
+        }
+
+        Type GetType() const { return type_; }
+
+        // Calls f with the value as GetValue hands it out (int_t, real_t, StrView, Span<int_t>,
+        // Span<real_t> or Span<StrView>) and returns its result; for an unknown value f is not
+        // called and R() is returned. The switch compiles to one jump table.
+        template <typename F, typename R = decltype(std::declval<F>()(int_t()))>
+        R Visit(F&& f) const
+        {
+            switch (type_)
+            {
+            case Type::kInt: return f(Get(detail::TypeTag<Type::kInt>()));
+            case Type::kReal: return f(Get(detail::TypeTag<Type::kReal>()));
+            case Type::kStr: return f(Get(detail::TypeTag<Type::kStr>()));
+            case Type::kVInt: return f(Get(detail::TypeTag<Type::kVInt>()));
+            case Type::kVReal: return f(Get(detail::TypeTag<Type::kVReal>()));
+            case Type::kVStr: return f(Get(detail::TypeTag<Type::kVStr>()));
+            default: return R();
+            }
+        }
+
+        // The resource of the current out-of-line payload, or nullptr for the heap or none.
+        MemoryResource* GetResource() const { return OwnsBlock() ? u_[0].b->resource : nullptr; }
+
+        friend bool operator== (const TData& lhs, const TData& rhs);
+        friend struct ExactEqual;
+
+    private:
+        union Storage
+        {
+            int_t i;
+            real_t r;
+            detail::Block* b;
+        };
+
+        enum : std::size_t
+        {
+            kInlineWords = TDATA_INLINE_WORDS,
+            // An inline string starts right after the three header bytes.
+            kInlineCharsOffset = 3,
+            kInlineChars = 8 - kInlineCharsOffset + 8 * kInlineWords,
+        };
+
+        enum Flags : uint8_t
+        {
+            // The string or vector is in u_ (or from byte 3 on for a string), small_ long.
+            kInline = 1 << 0,
+            // u_[0].b is a kStr block owned by an Interner.
+            kShared = 1 << 1,
+            // The elements of a kVStr point into an Interner's blocks.
+            kInterned = 1 << 2,
+        };
+
+        // How a decoder reads [first, last): a text record whose '$' is yet to be found, a
+        // binary record, or a text record whose '$' is last - 1.
+        enum class Form : uint8_t
+        {
+            kText,
+            kBinary,
+            kRecord,
+        };
+
+        void SetType(Type type)
+        {
+            type_ = type;
+            flags_ = 0;
+            small_ = 0;
+            if (HasBlockType())
+            {
+                u_[0].b = nullptr;
+            }
+        }
+
+        bool HasBlockType() const { return Type::kStr == type_ || Type::kVInt == type_ || Type::kVReal == type_ || Type::kVStr == type_; }
+        bool IsInline() const { return 0 != (flags_ & kInline); }
+        bool HasBlock() const { return HasBlockType() && !IsInline() && nullptr != u_[0].b; }
+        bool IsShared() const { return 0 != (flags_ & kShared); }
+        bool IsInterned() const { return 0 != (flags_ & kInterned); }
+        bool OwnsBlock() const { return HasBlock() && !IsShared(); }
+
+        // Frees an owned block and forgets a shared one; the caller overwrites u_.
+        void DropBlock()
+        {
+            if (OwnsBlock())
+            {
+                detail::Block::Free(u_[0].b);
+            }
+            flags_ &= ~(kShared | kInterned);
+        }
+
+        // The Resource() of the Interner that owns the pooled string v.
+        static const MemoryResource* PoolOf(StrView v) { return (reinterpret_cast<const detail::Block*>(v.data()) - 1)->resource; }
+
+        char* InlineChars() { return reinterpret_cast<char*>(this) + kInlineCharsOffset; }
+        const char* InlineChars() const { return reinterpret_cast<const char*>(this) + kInlineCharsOffset; }
+
+        int_t Get(detail::TypeTag<Type::kInt>) const { return u_[0].i; }
+        real_t Get(detail::TypeTag<Type::kReal>) const { return u_[0].r; }
+        StrView Get(detail::TypeTag<Type::kStr>) const
+        {
+            return IsInline() ? StrView(InlineChars(), small_) : HasBlock() ? StrView(u_[0].b->data(), u_[0].b->size) : StrView();
+        }
+        Span<int_t> Get(detail::TypeTag<Type::kVInt>) const { return Elements<int_t>(); }
+        Span<real_t> Get(detail::TypeTag<Type::kVReal>) const { return Elements<real_t>(); }
+        Span<StrView> Get(detail::TypeTag<Type::kVStr>) const { return Elements<StrView>(); }
+
+        template <typename N>
+        Span<N> Elements() const
+        {
+            if (IsInline())
+            {
+                return Span<N>(reinterpret_cast<const N*>(u_), small_);
+            }
+            return HasBlock() ? Span<N>(reinterpret_cast<const N*>(u_[0].b->data()), u_[0].b->size) : Span<N>();
+        }
+
+        void Assign(int_t v, detail::TypeTag<Type::kInt>, MemoryResource*) { u_[0].i = v; }
+        void Assign(real_t v, detail::TypeTag<Type::kReal>, MemoryResource*) { u_[0].r = v; }
+        void Assign(StrView v, detail::TypeTag<Type::kStr>, MemoryResource* r) { AssignBytes(v.data(), v.size(), v.size(), kInlineChars, InlineChars(), r); }
+        void Assign(Span<int_t> v, detail::TypeTag<Type::kVInt>, MemoryResource* r) { AssignBytes(v.data(), v.size() * sizeof(int_t), v.size(), kInlineWords, u_, r); }
+        void Assign(Span<real_t> v, detail::TypeTag<Type::kVReal>, MemoryResource* r) { AssignBytes(v.data(), v.size() * sizeof(real_t), v.size(), kInlineWords, u_, r); }
+        void Assign(Span<StrView> v, detail::TypeTag<Type::kVStr>, MemoryResource* r) { AssignStrs(v, r); }
+        void Assign(const vstr_t& v, detail::TypeTag<Type::kVStr>, MemoryResource* r) { AssignStrs(v, r); }
+
+        // A block of at least `bytes` capacity from resource: the current one when it fits, else
+        // a new one that the caller installs with Install once the source has been read.
+        detail::Block* Acquire(std::size_t bytes, MemoryResource* resource)
+        {
+            return OwnsBlock() && u_[0].b->resource == resource && u_[0].b->capacity >= bytes ? u_[0].b : detail::Block::Allocate(bytes, resource);
+        }
+
+        void Install(detail::Block* b)
+        {
+            if (OwnsBlock() && u_[0].b != b)
+            {
+                detail::Block::Free(u_[0].b);
+            }
+            flags_ &= ~(kInline | kShared | kInterned);
+            small_ = 0;
+            u_[0].b = b;
+        }
+
+        // Room for `bytes` bytes of a payload of `size` elements, inline when size fits in
+        // inline_size; the old contents are dropped. The caller fills it and calls Resize.
+        void* Reserve(std::size_t bytes, std::size_t size, std::size_t inline_size, void* inline_data, MemoryResource* resource)
+        {
+            if (0 == size)
+            {
+                Clear();
+                return inline_data;
+            }
+            if (size <= inline_size)
+            {
+                DropBlock();
+                flags_ |= kInline;
+                small_ = 0;
+                return inline_data;
+            }
+            Install(Acquire(bytes, resource));
+            u_[0].b->size = 0;
+            return u_[0].b->data();
+        }
+
+        void Resize(std::size_t size)
+        {
+            if (IsInline())
+            {
+                small_ = static_cast<uint8_t>(size);
+            }
+            else if (HasBlock())
+            {
+                u_[0].b->size = size;
+            }
+        }
+
+        // Whether [first, last) touches this value's own storage.
+        bool Overlaps(const char* first, const char* last) const
+        {
+            const auto self = reinterpret_cast<const char*>(this);
+            if (first < self + sizeof(*this) && last > self)
+            {
+                return true;
+            }
+            const auto b = HasBlock() ? reinterpret_cast<const char*>(u_[0].b) : nullptr;
+            return nullptr != b && first < u_[0].b->data() + u_[0].b->capacity && last > b;
+        }
+
+        const char* DecodeAs(detail::TypeTag<Type::kInt>, const char* first, const char* last, Form form, MemoryResource*)
+        {
+            int_t i;
+            const auto end = Form::kBinary == form ? tdata_traits<int_t>::FromBinary(i, first, last) : tdata_traits<int_t>::FromChars(i, first, last);
+            return nullptr != end && SetValue(i) ? end : nullptr;
+        }
+
+        const char* DecodeAs(detail::TypeTag<Type::kReal>, const char* first, const char* last, Form form, MemoryResource*)
+        {
+            real_t r;
+            const auto end = Form::kBinary == form ? tdata_traits<real_t>::FromBinary(r, first, last) : tdata_traits<real_t>::FromChars(r, first, last);
+            return nullptr != end && SetValue(r) ? end : nullptr;
+        }
+
+        template <Type type>
+        const char* DecodeAs(detail::TypeTag<type>, const char* first, const char* last, Form form, MemoryResource* resource)
+        {
+            return DecodeInPlace<type>(first, last, form, resource);
+        }
+
+        // Decodes the text (or binary) record of a string or vector at first into this value's
+        // storage. A record that lies in that storage is decoded from a copy.
+        template <Type type>
+        const char* DecodeInPlace(const char* first, const char* last, Form form, MemoryResource* resource, Interner* pool = nullptr)
+        {
+            if (Type::kUnknown != type_ && type != type_)
+            {
+                return nullptr;
+            }
+            if (Overlaps(first, last))
+            {
+                const str_t copy(first, last);
+                const auto end = DecodeInPlace<type>(copy.data(), copy.data() + copy.size(), form, resource, pool);
+                return nullptr != end ? first + (end - copy.data()) : nullptr;
+            }
+            const auto unknown = Type::kUnknown == type_;
+            if (unknown)
+            {
+                SetType(type);
+            }
+            const auto tag = detail::TypeTag<type>();
+            const char* end = nullptr;
+            if (Form::kBinary == form)
+            {
+                end = nullptr != pool ? ReadBinary(tag, first, last, *pool) : ReadBinary(tag, first, last, resource);
+            }
+            else
+            {
+                const auto stop = Form::kRecord == form ? last - 1 : detail::StrCoder::CheckTypeAndFindEnd(first, last, type);
+                if (nullptr != stop)
+                {
+                    end = nullptr != pool ? ReadChars(tag, first, stop, *pool) : ReadChars(tag, first, stop, resource);
+                }
+            }
+            if (nullptr == end)
+            {
+                if (unknown)
+                {
+                    Release();
+                }
+                else
+                {
+                    Clear();
+                }
+            }
+            return end;
+        }
+
+        // The text readers decode the record [first, end] of their type, end being its '$'.
+        const char* ReadChars(detail::TypeTag<Type::kStr>, const char* first, const char* end, MemoryResource* resource)
+        {
+            const auto n = static_cast<std::size_t>(end - first - 2);
+            const auto out = static_cast<char*>(Reserve(n, n, kInlineChars, InlineChars(), resource));
+            Resize(detail::StrCoder::DecodeTo(first + 2, end, out) - out);
+            return end + 1;
+        }
+
+        const char* ReadChars(detail::TypeTag<Type::kVInt>, const char* first, const char* end, MemoryResource* resource)
+        {
+            return ReadNumbers<int_t, detail::IntParser>(first, end, resource);
+        }
+
+        const char* ReadChars(detail::TypeTag<Type::kVReal>, const char* first, const char* end, MemoryResource* resource)
+        {
+            return ReadNumbers<real_t, detail::FloatParser>(first, end, resource);
+        }
+
+        const char* ReadChars(detail::TypeTag<Type::kVStr>, const char* first, const char* end, MemoryResource* resource)
+        {
+            std::size_t n = 0;
+            const char* p = nullptr;
+            if (!detail::StrCoder::ReadCount(first, end, 1, n, p))
+            {
+                return nullptr;
+            }
+            const auto head = n * sizeof(StrView);
+            const auto entries = static_cast<StrView*>(Reserve(head + (end - p), n, 0, u_, resource));
+            auto out = reinterpret_cast<char*>(entries) + head;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (p >= end || *p != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                const auto e = detail::StrCoder::Find(++p, end, kFieldSepChar);
+                const auto o = detail::StrCoder::DecodeTo(p, e, out);
+                entries[i] = StrView(out, o - out);
+                out = o;
+                p = e;
+            }
+            if (p != end)
+            {
+                return nullptr;
+            }
+            Resize(n);
+            return end + 1;
+        }
+
+        // The interning readers of kStr and kVStr; the numeric types never get here.
+        const char* ReadChars(detail::TypeTag<Type::kStr>, const char* first, const char* end, Interner& pool)
+        {
+            str_t scratch;
+            AssignInterned(Unescaped(first + 2, end, scratch), detail::TypeTag<Type::kStr>(), pool);
+            return end + 1;
+        }
+
+        const char* ReadChars(detail::TypeTag<Type::kVStr>, const char* first, const char* end, Interner& pool)
+        {
+            std::size_t n = 0;
+            const char* p = nullptr;
+            if (!detail::StrCoder::ReadCount(first, end, 1, n, p))
+            {
+                return nullptr;
+            }
+            const auto entries = static_cast<StrView*>(Reserve(n * sizeof(StrView), n, 0, u_, GetResource()));
+            str_t scratch;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (p >= end || *p != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                const auto e = detail::StrCoder::Find(++p, end, kFieldSepChar);
+                const auto b = pool.Intern(Unescaped(p, e, scratch));
+                entries[i] = StrView(b->data(), b->size);
+                p = e;
+            }
+            if (p != end)
+            {
+                return nullptr;
+            }
+            Resize(n);
+            flags_ |= kInterned;
+            return end + 1;
+        }
+
+        const char* ReadBinary(detail::TypeTag<Type::kStr>, const char* first, const char* last, Interner& pool)
         {
-            s += kBegSepStr + str_t(1, static_cast<str_t::value_type>(enum_value)) + std::to_string(v.size());
-            for (const auto& n : v)
+            const auto p = detail::BinCoder::CheckType(first, last, Type::kStr);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            const auto end = nullptr != p ? detail::BinCoder::ReadLen(p, last, 1, b, n) : nullptr;
+            if (nullptr != end)
             {
-                s += kFieldSepStr + detail::StrCoder::Encode(n);
+                AssignInterned(StrView(b, n), detail::TypeTag<Type::kStr>(), pool);
             }
-            s += kEndSepStr;
+            return end;
         }
-        static bool FromStr(value_type& v, const str_t& s, str_t::size_type* p = nullptr)
+
+        const char* ReadBinary(detail::TypeTag<Type::kVStr>, const char* first, const char* last, Interner& pool)
         {
-            str_t::size_type beg = (nullptr != p ? *p : 0);
-            auto end = beg;
-            if (!detail::StrCoder::CheckTypeAndFindEnd(s, enum_value, beg, end))
+            auto p = detail::BinCoder::CheckType(first, last, Type::kVStr);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            if (nullptr == p || nullptr == detail::BinCoder::ReadLen(p, last, 1, b, n))
             {
-                return false;
+                return nullptr;
             }
-            str_t::value_type* begptr = nullptr;
-            const auto endptr = &s[end];
-            auto size = std::strtoll(&s[beg], &begptr, 10);
-            v.reserve(v.size() + static_cast<typename value_type::size_type>(size));
-            while (0 != size--)
+            const auto entries = static_cast<StrView*>(Reserve(n * sizeof(StrView), n, 0, u_, GetResource()));
+            p = b;
+            for (std::size_t i = 0; i < n; ++i)
             {
-                assert(begptr < endptr);
-                auto ptr = ++begptr;
-                while (++ptr < endptr && (*ptr != kFieldSepChar || *(ptr - 1) == kTransChar))
+                const char* e = nullptr;
+                std::size_t len = 0;
+                if (nullptr == (p = detail::BinCoder::ReadLen(p, last, 1, e, len)))
                 {
+                    return nullptr;
                 }
-                v.push_back(detail::StrCoder::Decode(begptr, ptr));
-                begptr = ptr;
+                const auto pooled = pool.Intern(StrView(e, len));
+                entries[i] = StrView(pooled->data(), pooled->size);
             }
-            if (nullptr != p)
+            Resize(n);
+            flags_ |= kInterned;
+            return p;
+        }
+
+        template <Type type>
+        const char* ReadChars(detail::TypeTag<type>, const char*, const char*, Interner&) { return nullptr; }
+        template <Type type>
+        const char* ReadBinary(detail::TypeTag<type>, const char*, const char*, Interner&) { return nullptr; }
+
+        // The unescaped [b, e): the text itself when it has no escapes, else decoded into scratch.
+        static StrView Unescaped(const char* b, const char* e, str_t& scratch)
+        {
+            if (detail::StrCoder::FindEscape(b, e) == e)
             {
-                *p = ++end;
+                return StrView(b, e - b);
             }
-            return true;
+            scratch.clear();
+            detail::StrCoder::Decode(b, e, scratch);
+            return scratch;
         }
-    };
-    template <typename T>
-    const vstr_t tdata_traits<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, vstr_t>::value>::type>::null_value = value_type();
 
-    class TData
-    {
-    public:
-        TData() = default;
-        TData(const TData&) = default;
-        TData(TData&&) = default;
-        TData& operator= (const TData&) = default;
-        TData& operator= (TData&&) = default;
+        template <typename N, typename Parser>
+        const char* ReadNumbers(const char* first, const char* end, MemoryResource* resource)
+        {
+            std::size_t n = 0;
+            const char* p = nullptr;
+            if (!detail::StrCoder::ReadCount(first, end, 2, n, p))
+            {
+                return nullptr;
+            }
+            const auto out = static_cast<N*>(Reserve(n * sizeof(N), n, kInlineWords, u_, resource));
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (p >= end || *p != kFieldSepChar)
+                {
+                    return nullptr;
+                }
+                N x = 0;
+                const auto next = Parser::FromChars(p + 1, end, x);
+                if (next == p + 1)
+                {
+                    return nullptr;
+                }
+                p = next;
+                out[i] = x;
+            }
+            // The last element must run up to the '$': no trailing bytes, no extra elements.
+            if (p != end)
+            {
+                return nullptr;
+            }
+            Resize(n);
+            return end + 1;
+        }
 
-        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
-        explicit TData(T&& v) : type_(tdata_traits<T>::enum_value), data_(typename tdata_traits<T>::value_type(v)) {}
+        const char* ReadBinary(detail::TypeTag<Type::kStr>, const char* first, const char* last, MemoryResource* resource)
+        {
+            const auto p = detail::BinCoder::CheckType(first, last, Type::kStr);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            const auto end = nullptr != p ? detail::BinCoder::ReadLen(p, last, 1, b, n) : nullptr;
+            if (nullptr != end)
+            {
+                const auto out = Reserve(n, n, kInlineChars, InlineChars(), resource);
+                if (0 != n)
+                {
+                    std::memcpy(out, b, n);
+                }
+                Resize(n);
+            }
+            return end;
+        }
 
-        void Clear()
+        const char* ReadBinary(detail::TypeTag<Type::kVInt>, const char* first, const char* last, MemoryResource* resource)
         {
-            switch (GetType())
+            auto p = detail::BinCoder::CheckType(first, last, Type::kVInt);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            // Every varint takes at least a byte.
+            if (nullptr == p || nullptr == detail::BinCoder::ReadLen(p, last, 1, b, n))
             {
-            case Type::kInt: SetValue(tdata_traits<int_t>::null_value); break;
-            case Type::kReal: SetValue(tdata_traits<real_t>::null_value); break;
-            case Type::kStr: SetValue(tdata_traits<str_t>::null_value); break;
-            case Type::kVInt: SetValue(tdata_traits<vint_t>::null_value); break;
-            case Type::kVReal: SetValue(tdata_traits<vreal_t>::null_value); break;
-            case Type::kVStr: SetValue(tdata_traits<vstr_t>::null_value); break;
-            default: break;
+                return nullptr;
+            }
+            const auto out = static_cast<int_t*>(Reserve(n * sizeof(int_t), n, kInlineWords, u_, resource));
+            p = b;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (nullptr == (p = detail::BinCoder::ReadInt(p, last, out[i])))
+                {
+                    return nullptr;
+                }
             }
+            Resize(n);
+            return p;
         }
 
-        bool IsNull() const
+        const char* ReadBinary(detail::TypeTag<Type::kVReal>, const char* first, const char* last, MemoryResource* resource)
         {
-            switch (GetType())
+            const auto p = detail::BinCoder::CheckType(first, last, Type::kVReal);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            const auto end = nullptr != p ? detail::BinCoder::ReadLen(p, last, sizeof(real_t), b, n) : nullptr;
+            if (nullptr != end)
             {
-            case Type::kInt: return tdata_traits<int_t>::null_value == GetValue<int_t>();
-            case Type::kReal: return tdata_traits<real_t>::null_value == GetValue<real_t>();
-            case Type::kStr: return tdata_traits<str_t>::null_value == GetValue<str_t>();
-            case Type::kVInt: return tdata_traits<vint_t>::null_value == GetValue<vint_t>();
-            case Type::kVReal: return tdata_traits<vreal_t>::null_value == GetValue<vreal_t>();
-            case Type::kVStr: return tdata_traits<vstr_t>::null_value == GetValue<vstr_t>();
-            default: break;
+                const auto out = static_cast<real_t*>(Reserve(n * sizeof(real_t), n, kInlineWords, u_, resource));
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    detail::BinCoder::ReadReal(b + i * sizeof(real_t), end, out[i]);
+                }
+                Resize(n);
             }
-            return true;
+            return end;
         }
 
-        str_t ToStr() const
+        const char* ReadBinary(detail::TypeTag<Type::kVStr>, const char* first, const char* last, MemoryResource* resource)
         {
-            str_t str;
-            switch (GetType())
+            auto p = detail::BinCoder::CheckType(first, last, Type::kVStr);
+            const char* b = nullptr;
+            std::size_t n = 0;
+            if (nullptr == p || nullptr == detail::BinCoder::ReadLen(p, last, 1, b, n))
             {
-            case Type::kInt: tdata_traits<int_t>::ToStr(GetValue<int_t>(), str); break;
-            case Type::kReal: tdata_traits<real_t>::ToStr(GetValue<real_t>(), str); break;
-            case Type::kStr: tdata_traits<str_t>::ToStr(GetValue<str_t>(), str); break;
-            case Type::kVInt: tdata_traits<vint_t>::ToStr(GetValue<vint_t>(), str); break;
-            case Type::kVReal: tdata_traits<vreal_t>::ToStr(GetValue<vreal_t>(), str); break;
-            case Type::kVStr: tdata_traits<vstr_t>::ToStr(GetValue<vstr_t>(), str); break;
-            default: break;
+                return nullptr;
             }
-            return str;
+            // A first pass sizes the block exactly, as last may be far beyond the record.
+            std::size_t chars = 0;
+            p = b;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const char* e = nullptr;
+                std::size_t len = 0;
+                if (nullptr == (p = detail::BinCoder::ReadLen(p, last, 1, e, len)))
+                {
+                    return nullptr;
+                }
+                chars += len;
+            }
+            const auto head = n * sizeof(StrView);
+            const auto entries = static_cast<StrView*>(Reserve(head + chars, n, 0, u_, resource));
+            auto out = reinterpret_cast<char*>(entries) + head;
+            p = b;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const char* e = nullptr;
+                std::size_t len = 0;
+                p = detail::BinCoder::ReadLen(p, last, 1, e, len);
+                if (0 != len)
+                {
+                    std::memcpy(out, e, len);
+                }
+                entries[i] = StrView(out, len);
+                out += len;
+            }
+            Resize(n);
+            return p;
         }
 
-        static bool FromStr(TData& v, const str_t& s, str_t::size_type* p = nullptr)
+        // Stores size elements of `bytes` bytes from p, inline when size fits in inline_size.
+        // p may point into this value's own storage.
+        void AssignBytes(const void* p, std::size_t bytes, std::size_t size, std::size_t inline_size, void* inline_data, MemoryResource* resource)
         {
-            switch (detail::StrCoder::GetType(s, nullptr != p ? *p : 0))
+            if (size <= inline_size)
             {
-            case Type::kInt: { int_t i; return tdata_traits<int_t>::FromStr(i, s, p) && v.SetValue(i); }
-            case Type::kReal: { real_t r; return tdata_traits<real_t>::FromStr(r, s, p) && v.SetValue(r); }
-            case Type::kStr: { str_t ss; return tdata_traits<str_t>::FromStr(ss, s, p) && v.SetValue(ss); }
-            case Type::kVInt: { vint_t vi; return tdata_traits<vint_t>::FromStr(vi, s, p) && v.SetValue(vi); }
-            case Type::kVReal: { vreal_t vr; return tdata_traits<vreal_t>::FromStr(vr, s, p) && v.SetValue(vr); }
-            case Type::kVStr: { vstr_t vs; return tdata_traits<vstr_t>::FromStr(vs, s, p) && v.SetValue(vs); }
-            default: return false;
+                // The inline bytes overlay the block pointer, which is freed only after the copy.
+                const auto old = OwnsBlock() ? u_[0].b : nullptr;
+                if (0 != bytes)
+                {
+                    std::memmove(inline_data, p, bytes);
+                }
+                detail::Block::Free(old);
+                flags_ &= ~(kShared | kInterned);
+                flags_ |= kInline;
+                small_ = static_cast<uint8_t>(size);
+                return;
             }
+            const auto b = Acquire(bytes, resource);
+            std::memmove(b->data(), p, bytes);
+            b->size = size;
+            Install(b);
         }
 
-        template <typename T>
-        bool SetValue(T&& v)
+        template <typename V>
+        void AssignStrs(const V& v, MemoryResource* resource)
         {
-            if (GetType() == Type::kUnknown)
+            std::size_t chars = 0;
+            for (const auto& n : v)
             {
-                SetType(tdata_traits<T>::enum_value);
+                chars += StrView(n).size();
             }
-            if (GetType() == tdata_traits<T>::enum_value)
+            if (v.size() == 0 && !HasBlock())
             {
-                data_.set<typename tdata_traits<T>::value_type>(v);
-                return true;
+                return;
             }
-            return false;
+            // The source may be this very block, so the elements are always rebuilt in a new one.
+            const auto head = v.size() * sizeof(StrView);
+            const auto b = detail::Block::Allocate(head + chars, resource);
+            auto entries = reinterpret_cast<StrView*>(b->data());
+            auto p = b->data() + head;
+            for (const auto& n : v)
+            {
+                const StrView e(n);
+                if (!e.empty())
+                {
+                    std::memcpy(p, e.data(), e.size());
+                }
+                *entries++ = StrView(p, e.size());
+                p += e.size();
+            }
+            b->size = v.size();
+            Install(b);
         }
 
-        template <typename T>
-        typename tdata_traits<T>::return_type GetValue() const
+        void Copy(const TData& o)
         {
-            if (GetType() == tdata_traits<T>::enum_value)
+            if (type_ != o.type_)
+            {
+                Release();
+                SetType(o.type_);
+            }
+            if (o.IsShared())
+            {
+                Share(o.u_[0].b);
+                return;
+            }
+            if (o.IsInterned())
+            {
+                AssignEntries(o.Elements<StrView>());
+                return;
+            }
+            switch (o.type_)
             {
-                return data_.get<typename tdata_traits<T>::value_type>();
+            case Type::kStr: Assign(o.GetValue<str_t>(), detail::TypeTag<Type::kStr>(), GetResource()); break;
+            case Type::kVInt: Assign(o.GetValue<vint_t>(), detail::TypeTag<Type::kVInt>(), GetResource()); break;
+            case Type::kVReal: Assign(o.GetValue<vreal_t>(), detail::TypeTag<Type::kVReal>(), GetResource()); break;
+            case Type::kVStr: Assign(o.GetValue<vstr_t>(), detail::TypeTag<Type::kVStr>(), GetResource()); break;
+            default: u_[0] = o.u_[0]; break;
             }
-            return tdata_traits<T>::null_value;
         }
 
-        Type GetType() const { return type_; }
-        const variant_t& GetData() const { return data_; }
+        // Takes over o's payload; o keeps its type with an empty value.
+        void Steal(TData& o)
+        {
+            type_ = o.type_;
+            flags_ = o.flags_;
+            small_ = o.small_;
+            std::memcpy(head_, o.head_, sizeof(head_));
+            std::copy(o.u_, o.u_ + kInlineWords, u_);
+            if (o.HasBlockType())
+            {
+                o.SetType(o.type_);
+            }
+        }
 
-    private:
-        void SetType(Type type) { type_ = type; }
+        // Points a kStr at the pooled block b.
+        void Share(const detail::Block* b)
+        {
+            DropBlock();
+            flags_ = kShared;
+            small_ = 0;
+            u_[0].b = const_cast<detail::Block*>(b);
+        }
+
+        // Makes a kVStr of the pooled strings v, copying only the entries.
+        void AssignEntries(Span<StrView> v)
+        {
+            if (v.empty())
+            {
+                Clear();
+                return;
+            }
+            const auto bytes = v.size() * sizeof(StrView);
+            const auto b = Acquire(bytes, GetResource());
+            std::memmove(b->data(), v.data(), bytes);
+            b->size = v.size();
+            Install(b);
+            flags_ |= kInterned;
+        }
+
+        void AssignInterned(StrView v, detail::TypeTag<Type::kStr>, Interner& pool)
+        {
+            if (v.size() <= kInlineChars)
+            {
+                Assign(v, detail::TypeTag<Type::kStr>(), GetResource());
+            }
+            else
+            {
+                Share(pool.Intern(v));
+            }
+        }
+
+        template <typename V>
+        void AssignInterned(const V& v, detail::TypeTag<Type::kVStr>, Interner& pool)
+        {
+            const auto n = v.size();
+            const auto entries = static_cast<StrView*>(Reserve(n * sizeof(StrView), n, 0, u_, GetResource()));
+            std::size_t i = 0;
+            for (const auto& e : v)
+            {
+                const auto b = pool.Intern(StrView(e));
+                entries[i++] = StrView(b->data(), b->size);
+            }
+            Resize(n);
+            flags_ |= kInterned;
+        }
+
+        template <typename V, Type type, typename = typename std::enable_if<Type::kStr != type && Type::kVStr != type>::type>
+        void AssignInterned(V&& v, detail::TypeTag<type> tag, Interner&)
+        {
+            Assign(std::forward<V>(v), tag, GetResource());
+        }
+
+        // Equality of two kStr or two kVStr: pooled strings of one Interner are equal exactly
+        // when they are the same copy.
+        static bool EqualStr(const TData& lhs, const TData& rhs)
+        {
+            if (lhs.IsShared() && rhs.IsShared() && lhs.u_[0].b->resource == rhs.u_[0].b->resource)
+            {
+                return lhs.u_[0].b == rhs.u_[0].b;
+            }
+            return lhs.Get(detail::TypeTag<Type::kStr>()) == rhs.Get(detail::TypeTag<Type::kStr>());
+        }
+
+        static bool EqualStrs(const TData& lhs, const TData& rhs)
+        {
+            const auto a = lhs.Elements<StrView>();
+            const auto b = rhs.Elements<StrView>();
+            if (a.size() != b.size())
+            {
+                return false;
+            }
+            const auto pooled = lhs.IsInterned() && rhs.IsInterned();
+            for (std::size_t i = 0; i < a.size(); ++i)
+            {
+                if (a[i].data() == b[i].data() && a[i].size() == b[i].size())
+                {
+                    continue;
+                }
+                if ((pooled && PoolOf(a[i]) == PoolOf(b[i])) || a[i] != b[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Frees the block, leaving an unknown value.
+        void Release()
+        {
+            DropBlock();
+            SetType(Type::kUnknown);
+            u_[0].i = 0;
+        }
 
     private:
         Type type_ = Type::kUnknown;
-        variant_t data_;
+        uint8_t flags_ = 0;
+        // Length of an inline payload.
+        uint8_t small_ = 0;
+        // The first chars of an inline string, which continues into u_.
+        char head_[8 - kInlineCharsOffset];
+        Storage u_[kInlineWords];
     };
 
-    bool operator== (const TData& lhs, const TData& rhs)
+    static_assert(TDATA_INLINE_WORDS >= 1 && TDATA_INLINE_WORDS <= 30, "TDATA_INLINE_WORDS is 1 to 30");
+    static_assert(sizeof(TData) == 8 + 8 * TDATA_INLINE_WORDS, "TData is a header word and TDATA_INLINE_WORDS words");
+
+    inline bool operator== (const TData& lhs, const TData& rhs)
     {
         if (lhs.GetType() != rhs.GetType())
         {
             return false;
         }
-        assert(lhs.GetData().valid() && rhs.GetData().valid());
-        if (lhs.GetData().which() != rhs.GetData().which())
+        const detail::equal_comp eq;
+        switch (lhs.GetType())
         {
-            return false;
+        case Type::kInt: return eq(lhs.GetValue<int_t>(), rhs.GetValue<int_t>());
+        case Type::kReal: return eq(lhs.GetValue<real_t>(), rhs.GetValue<real_t>());
+        case Type::kStr: return TData::EqualStr(lhs, rhs);
+        case Type::kVInt: return eq(lhs.GetValue<vint_t>(), rhs.GetValue<vint_t>());
+        case Type::kVReal: return eq(lhs.GetValue<vreal_t>(), rhs.GetValue<vreal_t>());
+        case Type::kVStr: return TData::EqualStrs(lhs, rhs);
+        default: return true;
+        }
+    }
+    inline bool operator!= (const TData& lhs, const TData& rhs) { return !(lhs == rhs); }
+
+    static const std::size_t kNoMismatch = static_cast<std::size_t>(-1);
+
+    // Where two values first differ, for diffing: kNoMismatch when they are equal, 0 when their
+    // types or scalar values differ, else the index of the first unequal element, which is the
+    // shorter length when one vector is a prefix of the other. Reals compare within tol.
+    inline std::size_t FindMismatch(const TData& lhs, const TData& rhs, const Tolerance& tol = Tolerance())
+    {
+        using detail::equal_comp;
+        if (lhs.GetType() != rhs.GetType())
+        {
+            return 0;
+        }
+        std::size_t i = 0;
+        std::size_t n = 0;
+        switch (lhs.GetType())
+        {
+        case Type::kInt: return lhs.GetValue<int_t>() == rhs.GetValue<int_t>() ? kNoMismatch : 0;
+        case Type::kReal: return detail::Mismatcher::Near(lhs.GetValue<real_t>(), rhs.GetValue<real_t>(), tol) ? kNoMismatch : 0;
+        case Type::kStr: return lhs.GetValue<str_t>() == rhs.GetValue<str_t>() ? kNoMismatch : 0;
+        case Type::kVInt:
+            i = equal_comp::Mismatch(lhs.GetValue<vint_t>(), rhs.GetValue<vint_t>());
+            n = std::max(lhs.GetValue<vint_t>().size(), rhs.GetValue<vint_t>().size());
+            break;
+        case Type::kVReal:
+            i = equal_comp::Mismatch(lhs.GetValue<vreal_t>(), rhs.GetValue<vreal_t>(), tol);
+            n = std::max(lhs.GetValue<vreal_t>().size(), rhs.GetValue<vreal_t>().size());
+            break;
+        case Type::kVStr:
+            i = equal_comp::Mismatch(lhs.GetValue<vstr_t>(), rhs.GetValue<vstr_t>());
+            n = std::max(lhs.GetValue<vstr_t>().size(), rhs.GetValue<vstr_t>().size());
+            break;
+        default: return kNoMismatch;
+        }
+        return i == n ? kNoMismatch : i;
+    }
+
+    // operator== with a chosen tolerance for reals.
+    inline bool Equal(const TData& lhs, const TData& rhs, const Tolerance& tol) { return kNoMismatch == FindMismatch(lhs, rhs, tol); }
+
+    namespace detail {
+        // Three-way compares for the total order of TData: -1, 0 or 1.
+        struct TotalOrder
+        {
+            // Types in declaration order, kUnknown first.
+            static int Rank(Type t)
+            {
+                switch (t)
+                {
+                case Type::kInt: return 1;
+                case Type::kReal: return 2;
+                case Type::kStr: return 3;
+                case Type::kVInt: return 4;
+                case Type::kVReal: return 5;
+                case Type::kVStr: return 6;
+                default: return 0;
+                }
+            }
+
+            static int Compare(int_t lhs, int_t rhs) { return lhs < rhs ? -1 : rhs < lhs ? 1 : 0; }
+
+            // NaNs sort after every number and equal one another; -0 equals 0.
+            static int Compare(real_t lhs, real_t rhs)
+            {
+                if (lhs < rhs)
+                {
+                    return -1;
+                }
+                if (rhs < lhs)
+                {
+                    return 1;
+                }
+                return (lhs != lhs) - (rhs != rhs);
+            }
+
+            static int Compare(StrView lhs, StrView rhs)
+            {
+                const int r = lhs.compare(rhs);
+                return r < 0 ? -1 : r > 0 ? 1 : 0;
+            }
+
+            // Lexicographic; a prefix sorts first.
+            template <typename T>
+            static int Compare(Span<T> lhs, Span<T> rhs)
+            {
+                const auto n = std::min(lhs.size(), rhs.size());
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (const int r = Compare(lhs[i], rhs[i]))
+                    {
+                        return r;
+                    }
+                }
+                return lhs.size() < rhs.size() ? -1 : rhs.size() < lhs.size() ? 1 : 0;
+            }
+        };
+    }
+
+    // Total order of values: by type in declaration order, then by value, with vectors
+    // lexicographic and NaN after every other real. Values it finds equivalent are the ones
+    // ExactEqual finds equal, so it sorts and binary-searches safely.
+    inline int Compare(const TData& lhs, const TData& rhs)
+    {
+        using detail::TotalOrder;
+        if (lhs.GetType() != rhs.GetType())
+        {
+            return TotalOrder::Rank(lhs.GetType()) < TotalOrder::Rank(rhs.GetType()) ? -1 : 1;
+        }
+        switch (lhs.GetType())
+        {
+        case Type::kInt: return TotalOrder::Compare(lhs.GetValue<int_t>(), rhs.GetValue<int_t>());
+        case Type::kReal: return TotalOrder::Compare(lhs.GetValue<real_t>(), rhs.GetValue<real_t>());
+        case Type::kStr: return TotalOrder::Compare(lhs.GetValue<str_t>(), rhs.GetValue<str_t>());
+        case Type::kVInt: return TotalOrder::Compare(lhs.GetValue<vint_t>(), rhs.GetValue<vint_t>());
+        case Type::kVReal: return TotalOrder::Compare(lhs.GetValue<vreal_t>(), rhs.GetValue<vreal_t>());
+        case Type::kVStr: return TotalOrder::Compare(lhs.GetValue<vstr_t>(), rhs.GetValue<vstr_t>());
+        default: return 0;
         }
-        mapbox::util::detail::comparer<variant_t, detail::equal_comp> visitor(lhs.GetData());
-        return variant_t::visit(rhs.GetData(), visitor);
     }
-    bool operator!= (const TData& lhs, const TData& rhs) { return !(lhs == rhs); }
+    inline bool operator< (const TData& lhs, const TData& rhs) { return Compare(lhs, rhs) < 0; }
+    inline bool operator> (const TData& lhs, const TData& rhs) { return Compare(lhs, rhs) > 0; }
+    inline bool operator<= (const TData& lhs, const TData& rhs) { return Compare(lhs, rhs) <= 0; }
+    inline bool operator>= (const TData& lhs, const TData& rhs) { return Compare(lhs, rhs) >= 0; }
+
+    // Equality for hashing: reals match exactly, except that -0 equals 0 and NaN equals NaN.
+    // operator== allows an epsilon between reals, which no hash can agree with, so key
+    // unordered containers as std::unordered_map<TData, V, std::hash<TData>, ExactEqual>.
+    struct ExactEqual
+    {
+        static bool Equal(real_t lhs, real_t rhs) { return lhs == rhs || (lhs != lhs && rhs != rhs); }
+
+        bool operator()(const TData& lhs, const TData& rhs) const
+        {
+            if (lhs.GetType() != rhs.GetType())
+            {
+                return false;
+            }
+            switch (lhs.GetType())
+            {
+            case Type::kInt: return lhs.GetValue<int_t>() == rhs.GetValue<int_t>();
+            case Type::kReal: return Equal(lhs.GetValue<real_t>(), rhs.GetValue<real_t>());
+            case Type::kStr: return TData::EqualStr(lhs, rhs);
+            case Type::kVInt:
+            {
+                const auto a = lhs.GetValue<vint_t>();
+                const auto b = rhs.GetValue<vint_t>();
+                return a.size() == b.size() && (a.empty() || 0 == std::memcmp(a.data(), b.data(), a.size() * sizeof(int_t)));
+            }
+            case Type::kVReal:
+            {
+                const auto a = lhs.GetValue<vreal_t>();
+                const auto b = rhs.GetValue<vreal_t>();
+                if (a.size() != b.size())
+                {
+                    return false;
+                }
+                for (std::size_t i = 0; i < a.size(); ++i)
+                {
+                    if (!Equal(a[i], b[i]))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case Type::kVStr: return TData::EqualStrs(lhs, rhs);
+            default: return true;
+            }
+        }
+    };
+
+    // Hash consistent with ExactEqual. Vectors of numbers go through detail::Hasher::Words.
+    struct TDataHash
+    {
+        std::size_t operator()(const TData& v) const
+        {
+            using detail::Hasher;
+            const auto seed = static_cast<uint64_t>(v.GetType()) * 0x9e3779b97f4a7c15ULL;
+            switch (v.GetType())
+            {
+            case Type::kInt: return static_cast<std::size_t>(Hasher::Mix(seed ^ static_cast<uint64_t>(v.GetValue<int_t>())));
+            case Type::kReal: return static_cast<std::size_t>(Hasher::Mix(seed ^ Hasher::RealBits(v.GetValue<real_t>())));
+            case Type::kStr:
+            {
+                const auto s = v.GetValue<str_t>();
+                return static_cast<std::size_t>(Hasher::Mix(seed ^ Hasher::Bytes(s.data(), s.size())));
+            }
+            case Type::kVInt:
+            {
+                const auto a = v.GetValue<vint_t>();
+                const auto p = reinterpret_cast<const char*>(a.data());
+                return static_cast<std::size_t>(Hasher::Mix(Hasher::Words(p, a.size(), seed ^ a.size(), Hasher::RawWord())));
+            }
+            case Type::kVReal:
+            {
+                const auto a = v.GetValue<vreal_t>();
+                const auto p = reinterpret_cast<const char*>(a.data());
+                return static_cast<std::size_t>(Hasher::Mix(Hasher::Words(p, a.size(), seed ^ a.size(), Hasher::RealWord())));
+            }
+            case Type::kVStr:
+            {
+                auto h = seed ^ v.GetValue<vstr_t>().size();
+                for (const auto& e : v.GetValue<vstr_t>())
+                {
+                    h = Hasher::Round(h, Hasher::Bytes(e.data(), e.size()));
+                }
+                return static_cast<std::size_t>(Hasher::Mix(h));
+            }
+            default: return static_cast<std::size_t>(seed);
+            }
+        }
+    };
+
+    // Encodes many values back to back into one buffer that is reused across messages:
+    // once the buffer has grown to the message size, Append does no heap allocation.
+    template <typename B = str_t>
+    class BasicEncoder
+    {
+    public:
+        using buffer_type = B;
+        using size_type = typename buffer_type::size_type;
+
+        BasicEncoder() = default;
+        explicit BasicEncoder(size_type capacity) { buf_.reserve(capacity); }
+
+        BasicEncoder& Append(const TData& v)
+        {
+            v.ToStr(buf_);
+            return *this;
+        }
+
+        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
+        BasicEncoder& Append(const T& v)
+        {
+            tdata_traits<T>::ToStr(v, buf_);
+            return *this;
+        }
+
+        // Drops the encoded bytes but keeps the capacity.
+        void Clear() { buf_.clear(); }
+
+        const buffer_type& Buffer() const { return buf_; }
+        buffer_type& Buffer() { return buf_; }
+        const char* Data() const { return buf_.data(); }
+        size_type Size() const { return buf_.size(); }
+
+    private:
+        buffer_type buf_;
+    };
+
+    using Encoder = BasicEncoder<>;
+}
+
+namespace std {
+    template <>
+    struct hash<tdata::TData> : tdata::TDataHash {};
 }
 
 #endif // !__TDATA_HPP__
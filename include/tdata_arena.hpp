@@ -0,0 +1,113 @@
+#ifndef __TDATA_ARENA_HPP__
+#define __TDATA_ARENA_HPP__
+
+#include "tdata.hpp"
+
+
+namespace tdata {
+    // A monotonic MemoryResource for decoding a batch: allocations bump a pointer through large
+    // chunks, Deallocate does nothing, and the whole batch goes at once with Reset or the
+    // destructor. Not thread-safe; give each thread its own arena. Destroy or Clear the TData
+    // values that use it before calling Reset, and do not let them outlive it.
+    class Arena : public MemoryResource
+    {
+    public:
+        static constexpr std::size_t kDefaultChunkSize = 64 << 10;
+
+        explicit Arena(std::size_t chunk_size = kDefaultChunkSize) : chunk_size_(chunk_size < 64 ? 64 : chunk_size) {}
+        Arena(const Arena&) = delete;
+        Arena& operator= (const Arena&) = delete;
+        ~Arena() { FreeChunks(nullptr); }
+
+        void* Allocate(std::size_t bytes) override
+        {
+            bytes = (bytes + 7) & ~static_cast<std::size_t>(7);
+            if (static_cast<std::size_t>(end_ - cur_) < bytes)
+            {
+                Grow(bytes);
+            }
+            const auto p = cur_;
+            cur_ += bytes;
+            allocated_ += bytes;
+            return p;
+        }
+
+        void Deallocate(void*, std::size_t) override {}
+
+        // Forgets every allocation, keeping the newest (largest) chunk for the next batch.
+        void Reset()
+        {
+            if (nullptr != chunks_)
+            {
+                FreeChunks(chunks_);
+                chunks_->next = nullptr;
+                reserved_ = chunks_->size;
+                cur_ = chunks_->data();
+                end_ = cur_ + chunks_->size;
+            }
+            allocated_ = 0;
+        }
+
+        // Bytes handed out since the last Reset, and bytes held in chunks.
+        std::size_t Allocated() const { return allocated_; }
+        std::size_t Reserved() const { return reserved_; }
+
+    private:
+        struct Chunk
+        {
+            Chunk* next;
+            std::size_t size;
+
+            char* data() { return reinterpret_cast<char*>(this + 1); }
+        };
+
+        // Chains a chunk of at least `bytes`, each one twice the size of the last.
+        void Grow(std::size_t bytes)
+        {
+            auto size = nullptr != chunks_ ? 2 * chunks_->size : chunk_size_;
+            while (size < bytes)
+            {
+                size *= 2;
+            }
+            const auto c = static_cast<Chunk*>(std::malloc(sizeof(Chunk) + size));
+            if (nullptr == c)
+            {
+                throw std::bad_alloc();
+            }
+            c->next = chunks_;
+            c->size = size;
+            chunks_ = c;
+            reserved_ += size;
+            cur_ = c->data();
+            end_ = cur_ + size;
+        }
+
+        // Frees the chunks after keep, or all of them when keep is null.
+        void FreeChunks(Chunk* keep)
+        {
+            auto c = nullptr != keep ? keep->next : chunks_;
+            while (nullptr != c)
+            {
+                const auto next = c->next;
+                std::free(c);
+                c = next;
+            }
+            if (nullptr == keep)
+            {
+                chunks_ = nullptr;
+                cur_ = end_ = nullptr;
+                reserved_ = 0;
+            }
+        }
+
+    private:
+        std::size_t chunk_size_;
+        Chunk* chunks_ = nullptr;
+        char* cur_ = nullptr;
+        char* end_ = nullptr;
+        std::size_t allocated_ = 0;
+        std::size_t reserved_ = 0;
+    };
+}
+
+#endif // !__TDATA_ARENA_HPP__
@@ -0,0 +1,314 @@
+#ifndef __TDATA_EQUAL_HPP__
+#define __TDATA_EQUAL_HPP__
+
+#include "tdata_scan.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+
+namespace tdata {
+    // How close two reals must be to count as equal. The default is operator==: an absolute
+    // difference below the machine epsilon. Relative scales the bound by the larger magnitude,
+    // and Ulps allows that many representable doubles between the two. NaN never matches.
+    struct Tolerance
+    {
+        enum class Mode : char { kAbsolute, kRelative, kUlps };
+
+        Mode mode = Mode::kAbsolute;
+        double eps = std::numeric_limits<double>::epsilon();
+        uint64_t ulps = 0;
+
+        static Tolerance Absolute(double eps)
+        {
+            Tolerance t;
+            t.eps = eps;
+            return t;
+        }
+
+        static Tolerance Relative(double rel)
+        {
+            Tolerance t;
+            t.mode = Mode::kRelative;
+            t.eps = rel;
+            return t;
+        }
+
+        static Tolerance Ulps(uint64_t n)
+        {
+            Tolerance t;
+            t.mode = Mode::kUlps;
+            t.ulps = n;
+            return t;
+        }
+    };
+
+    namespace detail {
+        // First-mismatch searches over arrays of int64_t and double: each returns the index of
+        // the first pair that differs, or n. Like Scanner, the widest kernel the CPU supports
+        // is chosen on first use; the SIMD ones test several vectors per step and only look at
+        // single elements in the block that holds the mismatch.
+        struct Mismatcher
+        {
+            using ints_fn = std::size_t (*)(const int64_t*, const int64_t*, std::size_t);
+            using reals_fn = std::size_t (*)(const double*, const double*, std::size_t, const Tolerance&);
+
+            // Equal blocks are skipped with memcmp, which the C library tunes to the CPU; only
+            // the block that differs is searched element by element.
+            static std::size_t Ints(const int64_t* a, const int64_t* b, std::size_t n)
+            {
+                static const ints_fn fn = SelectInts();
+                std::size_t i = 0;
+                for (; n - i > kIntBlock; i += kIntBlock)
+                {
+                    if (0 != std::memcmp(a + i, b + i, kIntBlock * sizeof(int64_t)))
+                    {
+                        break;
+                    }
+                }
+                return i + fn(a + i, b + i, n - i);
+            }
+
+            static std::size_t Reals(const double* a, const double* b, std::size_t n, const Tolerance& tol)
+            {
+                static const reals_fn fn = SelectReals();
+                return fn(a, b, n, tol);
+            }
+
+            static bool Near(double a, double b, const Tolerance& tol)
+            {
+                switch (tol.mode)
+                {
+                case Tolerance::Mode::kRelative:
+                {
+                    const auto d = Abs(a - b);
+                    return a == b || d <= tol.eps * (Abs(a) > Abs(b) ? Abs(a) : Abs(b));
+                }
+                case Tolerance::Mode::kUlps:
+                {
+                    if (a != a || b != b)
+                    {
+                        return false;
+                    }
+                    const auto x = UlpKey(a);
+                    const auto y = UlpKey(b);
+                    return (x > y ? x - y : y - x) <= tol.ulps;
+                }
+                default: return Abs(a - b) < tol.eps;
+                }
+            }
+
+            static std::size_t IntsScalar(const int64_t* a, const int64_t* b, std::size_t n)
+            {
+                std::size_t i = 0;
+                while (i < n && a[i] == b[i])
+                {
+                    ++i;
+                }
+                return i;
+            }
+
+            static std::size_t RealsScalar(const double* a, const double* b, std::size_t n, const Tolerance& tol)
+            {
+                std::size_t i = 0;
+                while (i < n && Near(a[i], b[i], tol))
+                {
+                    ++i;
+                }
+                return i;
+            }
+
+#ifdef TDATA_HAS_SSE2
+            static std::size_t IntsSse2(const int64_t* a, const int64_t* b, std::size_t n)
+            {
+                std::size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    const auto x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                    const auto y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                    const auto x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 2));
+                    const auto y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 2));
+                    const auto eq = _mm_and_si128(_mm_cmpeq_epi8(x0, y0), _mm_cmpeq_epi8(x1, y1));
+                    if (0xffff != _mm_movemask_epi8(eq))
+                    {
+                        break;
+                    }
+                }
+                return i + IntsScalar(a + i, b + i, n - i);
+            }
+
+            // The absolute mode only; the others fall back to Near.
+            static std::size_t RealsSse2(const double* a, const double* b, std::size_t n, const Tolerance& tol)
+            {
+                std::size_t i = 0;
+                if (Tolerance::Mode::kAbsolute == tol.mode)
+                {
+                    const auto sign = _mm_set1_pd(-0.0);
+                    const auto eps = _mm_set1_pd(tol.eps);
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        const auto d0 = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+                        const auto d1 = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+                        if (3 != _mm_movemask_pd(_mm_and_pd(_mm_cmplt_pd(d0, eps), _mm_cmplt_pd(d1, eps))))
+                        {
+                            break;
+                        }
+                    }
+                }
+                return i + RealsScalar(a + i, b + i, n - i, tol);
+            }
+#endif
+
+#ifdef TDATA_HAS_AVX2
+            __attribute__((target("avx2")))
+            static std::size_t IntsAvx2(const int64_t* a, const int64_t* b, std::size_t n)
+            {
+                std::size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    const auto p = reinterpret_cast<const __m256i*>(a + i);
+                    const auto q = reinterpret_cast<const __m256i*>(b + i);
+                    const auto d0 = _mm256_xor_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(q));
+                    const auto d1 = _mm256_xor_si256(_mm256_loadu_si256(p + 1), _mm256_loadu_si256(q + 1));
+                    const auto d2 = _mm256_xor_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(q + 2));
+                    const auto d3 = _mm256_xor_si256(_mm256_loadu_si256(p + 3), _mm256_loadu_si256(q + 3));
+                    const auto diff = _mm256_or_si256(_mm256_or_si256(d0, d1), _mm256_or_si256(d2, d3));
+                    if (!_mm256_testz_si256(diff, diff))
+                    {
+                        break;
+                    }
+                }
+                return i + IntsScalar(a + i, b + i, n - i);
+            }
+
+            __attribute__((target("avx2")))
+            static std::size_t RealsAvx2(const double* a, const double* b, std::size_t n, const Tolerance& tol)
+            {
+                std::size_t i = 0;
+                const auto sign = _mm256_set1_pd(-0.0);
+                const auto eps = _mm256_set1_pd(tol.eps);
+                switch (tol.mode)
+                {
+                case Tolerance::Mode::kAbsolute:
+                    for (; i + 8 <= n; i += 8)
+                    {
+                        const auto d0 = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+                        const auto d1 = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+                        const auto ok = _mm256_and_pd(_mm256_cmp_pd(d0, eps, _CMP_LT_OQ), _mm256_cmp_pd(d1, eps, _CMP_LT_OQ));
+                        if (0xf != _mm256_movemask_pd(ok))
+                        {
+                            break;
+                        }
+                    }
+                    break;
+                case Tolerance::Mode::kRelative:
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        const auto x = _mm256_loadu_pd(a + i);
+                        const auto y = _mm256_loadu_pd(b + i);
+                        const auto d = _mm256_andnot_pd(sign, _mm256_sub_pd(x, y));
+                        const auto m = _mm256_max_pd(_mm256_andnot_pd(sign, x), _mm256_andnot_pd(sign, y));
+                        const auto ok = _mm256_or_pd(_mm256_cmp_pd(x, y, _CMP_EQ_OQ), _mm256_cmp_pd(d, _mm256_mul_pd(eps, m), _CMP_LE_OQ));
+                        if (0xf != _mm256_movemask_pd(ok))
+                        {
+                            break;
+                        }
+                    }
+                    break;
+                case Tolerance::Mode::kUlps:
+                {
+                    // Unsigned compares are signed ones with the top bit flipped.
+                    const auto top = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+                    const auto ulps = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(tol.ulps)), top);
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        const auto x = _mm256_loadu_pd(a + i);
+                        const auto y = _mm256_loadu_pd(b + i);
+                        const auto kx = UlpKeys(_mm256_castpd_si256(x));
+                        const auto ky = UlpKeys(_mm256_castpd_si256(y));
+                        const auto gt = _mm256_cmpgt_epi64(kx, ky);
+                        const auto d = _mm256_sub_epi64(_mm256_blendv_epi8(ky, kx, gt), _mm256_blendv_epi8(kx, ky, gt));
+                        const auto nan = _mm256_castpd_si256(_mm256_or_pd(_mm256_cmp_pd(x, x, _CMP_UNORD_Q), _mm256_cmp_pd(y, y, _CMP_UNORD_Q)));
+                        const auto bad = _mm256_or_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(d, top), ulps), nan);
+                        if (!_mm256_testz_si256(bad, bad))
+                        {
+                            break;
+                        }
+                    }
+                    break;
+                }
+                }
+                return i + RealsScalar(a + i, b + i, n - i, tol);
+            }
+#endif
+
+        private:
+            enum { kIntBlock = 256 };
+
+            static double Abs(double v) { return v < 0 ? -v : v; }
+
+            // Maps the bits of a non-NaN double to an unsigned key in numeric order, so that
+            // adjacent doubles get adjacent keys and -0 and 0 the same one.
+            static uint64_t UlpKey(double v)
+            {
+                uint64_t w;
+                std::memcpy(&w, &v, 8);
+                return 0 != (w >> 63) ? 0x8000000000000000ULL - (w & 0x7fffffffffffffffULL) : 0x8000000000000000ULL + w;
+            }
+
+#ifdef TDATA_HAS_AVX2
+            // UlpKey of four doubles with the top bit flipped: signed keys in numeric order.
+            __attribute__((target("avx2")))
+            static __m256i UlpKeys(__m256i w)
+            {
+                const auto zero = _mm256_setzero_si256();
+                const auto mag = _mm256_andnot_si256(_mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL)), w);
+                return _mm256_blendv_epi8(w, _mm256_sub_epi64(zero, mag), _mm256_cmpgt_epi64(zero, w));
+            }
+#endif
+
+            static bool HasAvx2()
+            {
+#ifdef TDATA_HAS_AVX2
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+#else
+                return false;
+#endif
+            }
+
+            static ints_fn SelectInts()
+            {
+#ifdef TDATA_HAS_AVX2
+                if (HasAvx2())
+                {
+                    return IntsAvx2;
+                }
+#endif
+#ifdef TDATA_HAS_SSE2
+                return IntsSse2;
+#else
+                return IntsScalar;
+#endif
+            }
+
+            static reals_fn SelectReals()
+            {
+#ifdef TDATA_HAS_AVX2
+                if (HasAvx2())
+                {
+                    return RealsAvx2;
+                }
+#endif
+#ifdef TDATA_HAS_SSE2
+                return RealsSse2;
+#else
+                return RealsScalar;
+#endif
+            }
+        };
+    }
+}
+
+#endif // !__TDATA_EQUAL_HPP__
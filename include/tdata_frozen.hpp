@@ -0,0 +1,266 @@
+#ifndef __TDATA_FROZEN_HPP__
+#define __TDATA_FROZEN_HPP__
+
+#include "tdata.hpp"
+
+
+namespace tdata {
+    // The frozen layout keeps every number where it can be read in place. A record is a sequence
+    // of 8-byte words, so consecutive records stay 8-byte aligned:
+    //   header   count << 8 | Type char
+    //   kInt     the int64_t                           (count 1)
+    //   kReal    the double                            (count 1)
+    //   kStr     count bytes, zero-padded to a word
+    //   kVInt    count int64_t
+    //   kVReal   count double
+    //   kVStr    count end offsets into the bytes that follow, then the bytes, zero-padded
+    // Words are in host order, which is little-endian on every platform tdata supports.
+    struct FrozenCoder
+    {
+        static constexpr std::size_t kWord = 8;
+
+        template <typename S>
+        static void Append(const TData& v, S& s)
+        {
+            switch (v.GetType())
+            {
+            case Type::kInt: Append(v.GetValue<int_t>(), s); break;
+            case Type::kReal: Append(v.GetValue<real_t>(), s); break;
+            case Type::kStr: Append(v.GetValue<str_t>(), s); break;
+            case Type::kVInt: Append(v.GetValue<vint_t>(), s); break;
+            case Type::kVReal: Append(v.GetValue<vreal_t>(), s); break;
+            case Type::kVStr: Append(v.GetValue<vstr_t>(), s); break;
+            default: break;
+            }
+        }
+
+        template <typename S>
+        static void Append(int_t v, S& s)
+        {
+            AppendHeader(s, Type::kInt, 1);
+            AppendWords(s, &v, 1);
+        }
+
+        template <typename S>
+        static void Append(real_t v, S& s)
+        {
+            AppendHeader(s, Type::kReal, 1);
+            AppendWords(s, &v, 1);
+        }
+
+        template <typename S>
+        static void Append(StrView v, S& s)
+        {
+            AppendHeader(s, Type::kStr, v.size());
+            s.append(v.data(), v.size());
+            Pad(s);
+        }
+
+        template <typename S>
+        static void Append(Span<int_t> v, S& s)
+        {
+            AppendHeader(s, Type::kVInt, v.size());
+            AppendWords(s, v.data(), v.size());
+        }
+
+        template <typename S>
+        static void Append(Span<real_t> v, S& s)
+        {
+            AppendHeader(s, Type::kVReal, v.size());
+            AppendWords(s, v.data(), v.size());
+        }
+
+        template <typename S>
+        static void Append(Span<StrView> v, S& s) { AppendStrs(v, s); }
+        template <typename S>
+        static void Append(const vstr_t& v, S& s) { AppendStrs(v, s); }
+
+    private:
+        template <typename V, typename S>
+        static void AppendStrs(const V& v, S& s)
+        {
+            AppendHeader(s, Type::kVStr, v.size());
+            uint64_t end = 0;
+            for (const auto& n : v)
+            {
+                end += n.size();
+                AppendWords(s, &end, 1);
+            }
+            for (const auto& n : v)
+            {
+                s.append(n.data(), n.size());
+            }
+            Pad(s);
+        }
+
+        template <typename S>
+        static void AppendHeader(S& s, Type type, std::size_t count)
+        {
+            Pad(s);
+            const uint64_t h = static_cast<uint64_t>(count) << 8 | static_cast<unsigned char>(type);
+            AppendWords(s, &h, 1);
+        }
+
+        template <typename S, typename W>
+        static void AppendWords(S& s, const W* p, std::size_t n)
+        {
+            static_assert(sizeof(W) == kWord, "frozen words are 8 bytes");
+            if (0 != n)
+            {
+                s.append(reinterpret_cast<const char*>(p), n * kWord);
+            }
+        }
+
+        // Zero-fills s up to the next word boundary.
+        template <typename S>
+        static void Pad(S& s)
+        {
+            const auto n = s.size() % kWord;
+            if (0 != n)
+            {
+                s.append(kWord - n, '\0');
+            }
+        }
+    };
+
+    // Non-owning view of one frozen record. Numeric vectors come back as spans straight into the
+    // buffer and strings as StrView, so reading a mapped file of frozen records copies nothing.
+    // The buffer must be 8-byte aligned (malloc and mmap memory is) and outlive the view.
+    class FrozenView
+    {
+    public:
+        using size_type = std::size_t;
+
+        FrozenView() = default;
+
+        // Binds v to the record that starts at first and returns its end, or nullptr when first is
+        // misaligned or [first, last) does not start with a well-formed record.
+        static const char* FromChars(FrozenView& v, const char* first, const char* last)
+        {
+            const auto kWord = FrozenCoder::kWord;
+            if (0 != reinterpret_cast<std::uintptr_t>(first) % kWord || last - first < static_cast<std::ptrdiff_t>(kWord))
+            {
+                return nullptr;
+            }
+            const auto h = *reinterpret_cast<const uint64_t*>(first);
+            const auto type = static_cast<Type>(static_cast<char>(h & 0xff));
+            const auto count = h >> 8;
+            const auto body = first + kWord;
+            const auto avail = static_cast<uint64_t>(last - body);
+            uint64_t bytes = 0;
+            switch (type)
+            {
+            case Type::kInt:
+            case Type::kReal:
+                if (1 != count)
+                {
+                    return nullptr;
+                }
+                bytes = kWord;
+                break;
+            case Type::kStr:
+                bytes = count;
+                break;
+            case Type::kVInt:
+            case Type::kVReal:
+                if (count > avail / kWord)
+                {
+                    return nullptr;
+                }
+                bytes = count * kWord;
+                break;
+            case Type::kVStr:
+            {
+                if (count > avail / kWord)
+                {
+                    return nullptr;
+                }
+                const auto ends = reinterpret_cast<const uint64_t*>(body);
+                for (uint64_t i = 1; i < count; ++i)
+                {
+                    if (ends[i] < ends[i - 1])
+                    {
+                        return nullptr;
+                    }
+                }
+                bytes = count * kWord;
+                if (0 != count)
+                {
+                    if (ends[count - 1] > avail - bytes)
+                    {
+                        return nullptr;
+                    }
+                    bytes += ends[count - 1];
+                }
+                break;
+            }
+            default:
+                return nullptr;
+            }
+            bytes = (bytes + kWord - 1) / kWord * kWord;
+            if (bytes > avail)
+            {
+                return nullptr;
+            }
+
+            v.type_ = type;
+            v.size_ = static_cast<size_type>(count);
+            v.body_ = body;
+            return body + bytes;
+        }
+
+        Type GetType() const { return type_; }
+        // Element count of a vector or byte length of a kStr, 1 for a number.
+        size_type Size() const { return size_; }
+
+        int_t GetInt() const { return Type::kInt == type_ ? *reinterpret_cast<const int_t*>(body_) : tdata_traits<int_t>::null_value; }
+        real_t GetReal() const { return Type::kReal == type_ ? *reinterpret_cast<const real_t*>(body_) : tdata_traits<real_t>::null_value; }
+        StrView GetStr() const { return Type::kStr == type_ ? StrView(body_, size_) : StrView(); }
+        Span<int_t> GetVInt() const { return Type::kVInt == type_ ? Span<int_t>(reinterpret_cast<const int_t*>(body_), size_) : Span<int_t>(); }
+        Span<real_t> GetVReal() const { return Type::kVReal == type_ ? Span<real_t>(reinterpret_cast<const real_t*>(body_), size_) : Span<real_t>(); }
+
+        // Element i of a kVStr.
+        StrView GetStr(size_type i) const
+        {
+            if (Type::kVStr != type_ || i >= size_)
+            {
+                return StrView();
+            }
+            const auto ends = reinterpret_cast<const uint64_t*>(body_);
+            const auto chars = body_ + size_ * FrozenCoder::kWord;
+            const auto beg = 0 == i ? 0 : ends[i - 1];
+            return StrView(chars + beg, static_cast<size_type>(ends[i] - beg));
+        }
+
+        // Copies the record into v.
+        bool ToTData(TData& v) const
+        {
+            switch (type_)
+            {
+            case Type::kInt: return v.SetValue(GetInt());
+            case Type::kReal: return v.SetValue(GetReal());
+            case Type::kStr: return v.SetValue(GetStr());
+            case Type::kVInt: return v.SetValue(GetVInt());
+            case Type::kVReal: return v.SetValue(GetVReal());
+            case Type::kVStr:
+            {
+                std::vector<StrView> vs;
+                vs.reserve(size_);
+                for (size_type i = 0; i < size_; ++i)
+                {
+                    vs.push_back(GetStr(i));
+                }
+                return v.SetValue(Span<StrView>(vs));
+            }
+            default: return false;
+            }
+        }
+
+    private:
+        Type type_ = Type::kUnknown;
+        size_type size_ = 0;
+        const char* body_ = nullptr;
+    };
+}
+
+#endif // !__TDATA_FROZEN_HPP__
@@ -0,0 +1,148 @@
+#ifndef __TDATA_INTERN_HPP__
+#define __TDATA_INTERN_HPP__
+
+#include "tdata.hpp"
+#include "tdata_arena.hpp"
+
+#include <mutex>
+#include <vector>
+
+
+namespace tdata {
+    // A thread-safe Interner for symbol-heavy data: strings are spread over shards by hash, each
+    // with its own lock, index and Arena, so decoders on several threads rarely wait on one
+    // another. Pooled strings live until the pool is destroyed, and so does the memory of its
+    // Resource(), which is monotonic: Deallocate does nothing.
+    class StrPool : public Interner
+    {
+    public:
+        static constexpr std::size_t kShards = 16;
+
+        StrPool() = default;
+        StrPool(const StrPool&) = delete;
+        StrPool& operator= (const StrPool&) = delete;
+
+        const detail::Block* Intern(StrView s) override
+        {
+            const auto h = detail::Hasher::Bytes(s.data(), s.size());
+            auto& shard = shards_[(h >> 32) % kShards];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto slot = shard.Find(h, s);
+            if (nullptr == slot->block)
+            {
+                const auto b = static_cast<detail::Block*>(shard.arena.Allocate(sizeof(detail::Block) + s.size()));
+                b->size = s.size();
+                b->capacity = s.size();
+                b->resource = &resource_;
+                if (!s.empty())
+                {
+                    std::memcpy(b->data(), s.data(), s.size());
+                }
+                slot = shard.Insert(h, b);
+            }
+            return slot->block;
+        }
+
+        MemoryResource& Resource() override { return resource_; }
+
+        // Distinct strings, and the bytes of their blocks.
+        std::size_t Size() const
+        {
+            std::size_t n = 0;
+            for (const auto& shard : shards_)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                n += shard.count;
+            }
+            return n;
+        }
+
+        std::size_t Bytes() const
+        {
+            std::size_t n = 0;
+            for (const auto& shard : shards_)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                n += shard.arena.Allocated();
+            }
+            return n;
+        }
+
+    private:
+        // An Arena behind a lock, for Resource() and as the tag of the pooled blocks.
+        class LockedArena : public MemoryResource
+        {
+        public:
+            void* Allocate(std::size_t bytes) override
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return arena_.Allocate(bytes);
+            }
+
+            void Deallocate(void*, std::size_t) override {}
+
+        private:
+            std::mutex mutex_;
+            Arena arena_;
+        };
+
+        struct Slot
+        {
+            uint64_t hash;
+            const detail::Block* block;
+        };
+
+        // A lock, an open-addressing index of the shard's strings and the Arena they live in.
+        struct Shard
+        {
+            Shard() : slots(64, Slot{ 0, nullptr }), arena(4 << 10) {}
+
+            // The slot of s, or the empty slot where it belongs.
+            Slot* Find(uint64_t h, StrView s)
+            {
+                const auto mask = slots.size() - 1;
+                for (auto i = static_cast<std::size_t>(h) & mask; ; i = (i + 1) & mask)
+                {
+                    auto& slot = slots[i];
+                    if (nullptr == slot.block
+                        || (slot.hash == h && slot.block->size == s.size() && 0 == std::memcmp(slot.block->data(), s.data(), s.size())))
+                    {
+                        return &slot;
+                    }
+                }
+            }
+
+            // Adds b, keeping the table at most half full, and returns its slot.
+            Slot* Insert(uint64_t h, const detail::Block* b)
+            {
+                if (2 * (count + 1) > slots.size())
+                {
+                    std::vector<Slot> old(2 * slots.size(), Slot{ 0, nullptr });
+                    old.swap(slots);
+                    for (const auto& o : old)
+                    {
+                        if (nullptr != o.block)
+                        {
+                            *Find(o.hash, StrView(o.block->data(), o.block->size)) = o;
+                        }
+                    }
+                }
+                ++count;
+                auto slot = Find(h, StrView(b->data(), b->size));
+                *slot = Slot{ h, b };
+                return slot;
+            }
+
+            mutable std::mutex mutex;
+            std::vector<Slot> slots;
+            std::size_t count = 0;
+            Arena arena;
+        };
+
+    private:
+        Shard shards_[kShards];
+        LockedArena resource_;
+    };
+}
+
+#endif // !__TDATA_INTERN_HPP__
@@ -0,0 +1,307 @@
+#ifndef __TDATA_MMAP_HPP__
+#define __TDATA_MMAP_HPP__
+
+#include "tdata_view.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#if !defined(TDATA_HAS_POSIX_IO) && (defined(__unix__) || defined(__APPLE__))
+#define TDATA_HAS_POSIX_IO
+#endif
+
+#ifdef TDATA_HAS_POSIX_IO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace tdata {
+    namespace detail {
+        // A read-only mapping of a whole file.
+        class MappedFile
+        {
+        public:
+            MappedFile() = default;
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator= (const MappedFile&) = delete;
+            ~MappedFile() { Close(); }
+
+            bool Open(const str_t& path)
+            {
+                Close();
+                const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                {
+                    return false;
+                }
+                struct stat st;
+                bool ok = 0 == ::fstat(fd, &st);
+                if (ok && 0 != st.st_size)
+                {
+                    const auto p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                    ok = MAP_FAILED != p;
+                    data_ = ok ? static_cast<const char*>(p) : nullptr;
+                }
+                if (ok)
+                {
+                    size_ = static_cast<std::size_t>(st.st_size);
+                    mtime_ = MTimeNs(st);
+                }
+                ::close(fd);
+                return ok;
+            }
+
+            void Close()
+            {
+                if (nullptr != data_)
+                {
+                    ::munmap(const_cast<char*>(data_), size_);
+                }
+                data_ = nullptr;
+                size_ = 0;
+                mtime_ = 0;
+            }
+
+            void Advise(int advice) const
+            {
+                if (nullptr != data_)
+                {
+                    ::madvise(const_cast<char*>(data_), size_, advice);
+                }
+            }
+
+            const char* data() const { return data_; }
+            std::size_t size() const { return size_; }
+            // Modification time in nanoseconds, so a rewrite within the same second still differs.
+            int64_t mtime() const { return mtime_; }
+
+        private:
+            static int64_t MTimeNs(const struct stat& st)
+            {
+#ifdef __APPLE__
+                const auto& t = st.st_mtimespec;
+#else
+                const auto& t = st.st_mtim;
+#endif
+                return static_cast<int64_t>(t.tv_sec) * 1000000000 + static_cast<int64_t>(t.tv_nsec);
+            }
+
+            const char* data_ = nullptr;
+            std::size_t size_ = 0;
+            int64_t mtime_ = 0;
+        };
+    }
+
+    // Read-only access to a file of concatenated text records, mapped instead of read into
+    // memory. Records can be walked in order without an index. Random access goes through
+    // an offset index, which is built by one scan of the file. It can be saved to a sidecar
+    // file and mapped back on the next open, so reopening a huge file costs two mmaps. A saved
+    // index is only used while the data file keeps the size and nanosecond mtime it was built
+    // for, and each offset is checked as it is read.
+    class RecordFile
+    {
+    public:
+        using size_type = std::size_t;
+
+        RecordFile() = default;
+        RecordFile(const RecordFile&) = delete;
+        RecordFile& operator= (const RecordFile&) = delete;
+
+        // Maps the data file; Count and Get need BuildIndex or LoadIndex first.
+        bool Open(const str_t& path)
+        {
+            Close();
+            return data_.Open(path);
+        }
+
+        // Maps the data file and the index at index_path, rebuilding and saving the index when
+        // it is missing or stale. Saving is best effort: an index that cannot be written, say to
+        // a read-only directory, is still used from memory.
+        bool Open(const str_t& path, const str_t& index_path)
+        {
+            if (!Open(path))
+            {
+                return false;
+            }
+            if (LoadIndex(index_path))
+            {
+                return true;
+            }
+            if (!BuildIndex())
+            {
+                return false;
+            }
+            SaveIndex(index_path);
+            return true;
+        }
+
+        void Close()
+        {
+            data_.Close();
+            DropIndex();
+        }
+
+        const char* Data() const { return data_.data(); }
+        size_type Size() const { return data_.size(); }
+
+        // Calls f(const TDataView&) on every record in file order. Returns false when the file
+        // holds anything but well-formed records.
+        template <typename F>
+        bool ForEach(F&& f) const
+        {
+            data_.Advise(MADV_SEQUENTIAL);
+            const auto last = Data() + Size();
+            TDataView v;
+            for (const char* p = Data(); p != last; )
+            {
+                if (nullptr == (p = TDataView::FromChars(v, p, last)))
+                {
+                    return false;
+                }
+                f(static_cast<const TDataView&>(v));
+            }
+            return true;
+        }
+
+        // Records the offset of every record; false when the file is malformed.
+        bool BuildIndex()
+        {
+            DropIndex();
+            data_.Advise(MADV_SEQUENTIAL);
+            const auto first = Data(), last = Data() + Size();
+            for (const char* p = first; p != last; )
+            {
+                built_.push_back(static_cast<uint64_t>(p - first));
+                const auto end = detail::StrCoder::CheckTypeAndFindEnd(p, last, detail::StrCoder::GetType(p, last));
+                if (nullptr == end || !detail::StrCoder::IsType(p[1]))
+                {
+                    DropIndex();
+                    return false;
+                }
+                p = end + 1;
+            }
+            built_.push_back(static_cast<uint64_t>(Size()));
+            offsets_ = built_.data();
+            count_ = built_.size() - 1;
+            return true;
+        }
+
+        // Maps an index written by SaveIndex; false when it is missing, stale or its header does
+        // not fit it. Only the first and last offsets are checked here, so loading touches no
+        // more than two pages of the index; Record checks the rest.
+        bool LoadIndex(const str_t& path)
+        {
+            DropIndex();
+            IndexHeader h;
+            if (!index_.Open(path) || index_.size() < sizeof(h))
+            {
+                DropIndex();
+                return false;
+            }
+            std::memcpy(&h, index_.data(), sizeof(h));
+            const auto offsets = reinterpret_cast<const uint64_t*>(index_.data() + sizeof(h));
+            if (0 != std::memcmp(h.magic, Magic(), sizeof(h.magic))
+                || h.data_size != Size() || h.data_mtime != data_.mtime()
+                || h.count >= (index_.size() - sizeof(h)) / sizeof(uint64_t)
+                || index_.size() != sizeof(h) + (h.count + 1) * sizeof(uint64_t)
+                || offsets[0] != 0 || offsets[h.count] != Size())
+            {
+                DropIndex();
+                return false;
+            }
+            data_.Advise(MADV_RANDOM);
+            offsets_ = offsets;
+            count_ = static_cast<size_type>(h.count);
+            return true;
+        }
+
+        // Writes the index next to the data; a temporary file renamed into place keeps a
+        // concurrent reader from seeing half of it.
+        bool SaveIndex(const str_t& path) const
+        {
+            if (!HasIndex())
+            {
+                return false;
+            }
+            IndexHeader h;
+            std::memcpy(h.magic, Magic(), sizeof(h.magic));
+            h.data_size = Size();
+            h.data_mtime = data_.mtime();
+            h.count = count_;
+            const auto tmp = path + ".tmp";
+            auto file = std::fopen(tmp.c_str(), "wb");
+            if (nullptr == file)
+            {
+                return false;
+            }
+            bool ok = std::fwrite(&h, sizeof(h), 1, file) == 1
+                && std::fwrite(offsets_, sizeof(uint64_t), count_ + 1, file) == count_ + 1;
+            ok = 0 == std::fclose(file) && ok;
+            ok = ok && 0 == std::rename(tmp.c_str(), path.c_str());
+            if (!ok)
+            {
+                std::remove(tmp.c_str());
+            }
+            return ok;
+        }
+
+        bool HasIndex() const { return nullptr != offsets_; }
+        size_type Count() const { return count_; }
+
+        // The text of record i, or an empty view when i is out of range or a corrupt index
+        // gives it offsets outside the file.
+        StrView Record(size_type i) const
+        {
+            if (i >= count_)
+            {
+                return StrView();
+            }
+            const auto b = offsets_[i], e = offsets_[i + 1];
+            return b <= e && e <= Size() ? StrView(Data() + b, static_cast<size_type>(e - b)) : StrView();
+        }
+
+        bool Get(size_type i, TDataView& v) const
+        {
+            const auto r = Record(i);
+            return !r.empty() && TDataView::FromChars(v, r.begin(), r.end()) == r.end();
+        }
+
+        bool Get(size_type i, TData& v) const
+        {
+            const auto r = Record(i);
+            return !r.empty() && TData::FromChars(v, r.begin(), r.end()) == r.end();
+        }
+
+    private:
+        struct IndexHeader
+        {
+            char magic[8];
+            uint64_t data_size;
+            int64_t data_mtime;
+            uint64_t count;
+        };
+
+        static const char* Magic() { return "TDATAIX2"; }
+
+        void DropIndex()
+        {
+            index_.Close();
+            built_.clear();
+            offsets_ = nullptr;
+            count_ = 0;
+        }
+
+    private:
+        detail::MappedFile data_;
+        detail::MappedFile index_;
+        std::vector<uint64_t> built_;
+        const uint64_t* offsets_ = nullptr;
+        size_type count_ = 0;
+    };
+}
+
+#endif // TDATA_HAS_POSIX_IO
+
+#endif // !__TDATA_MMAP_HPP__
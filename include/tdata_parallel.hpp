@@ -0,0 +1,416 @@
+#ifndef __TDATA_PARALLEL_HPP__
+#define __TDATA_PARALLEL_HPP__
+
+#include "tdata.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(TDATA_HAS_POSIX_IO) && (defined(__unix__) || defined(__APPLE__))
+#define TDATA_HAS_POSIX_IO
+#endif
+
+#ifdef TDATA_HAS_POSIX_IO
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+
+namespace tdata {
+    // Threads kept across the batches of Parallel, so a call wakes them instead of starting and
+    // joining new ones. A pool of `threads` (0 means one per core) owns threads - 1 workers;
+    // the caller of Run is the last. Run serves one batch at a time and must not be called from
+    // inside one of its own tasks.
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(unsigned threads = 0)
+        {
+            if (0 == threads)
+            {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            workers_.reserve(threads - 1);
+            for (unsigned i = 1; i < threads; ++i)
+            {
+                workers_.emplace_back([this]() { Loop(); });
+            }
+        }
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator= (const WorkerPool&) = delete;
+        ~WorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto& w : workers_)
+            {
+                w.join();
+            }
+        }
+
+        // The pool Parallel uses when it is given none, one thread per core.
+        static WorkerPool& Default()
+        {
+            static WorkerPool pool;
+            return pool;
+        }
+
+        unsigned Size() const { return static_cast<unsigned>(workers_.size() + 1); }
+
+        // Runs f(0) .. f(n - 1) over the workers and the calling thread and returns when all
+        // are done.
+        template <typename F>
+        void Run(std::size_t n, F&& f)
+        {
+            if (n <= 1 || workers_.empty())
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    f(i);
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> batch(batch_mutex_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                task_ = &Call<typename std::remove_reference<F>::type>;
+                context_ = const_cast<void*>(static_cast<const void*>(&f));
+                size_ = n;
+                next_ = 0;
+                busy_ = workers_.size();
+                ++batch_;
+            }
+            wake_.notify_all();
+            Work();
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this]() { return 0 == busy_; });
+        }
+
+    private:
+        template <typename F>
+        static void Call(void* f, std::size_t i) { (*static_cast<F*>(f))(i); }
+
+        // Takes indices of the current batch until none are left.
+        void Work()
+        {
+            for (auto i = next_.fetch_add(1); i < size_; i = next_.fetch_add(1))
+            {
+                task_(context_, i);
+            }
+        }
+
+        // A worker joins every batch once: a new batch only starts after all have left the last.
+        void Loop()
+        {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;)
+            {
+                wake_.wait(lock, [&]() { return stop_ || batch_ != seen; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen = batch_;
+                lock.unlock();
+                Work();
+                lock.lock();
+                if (0 == --busy_)
+                {
+                    done_.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread> workers_;
+        std::mutex batch_mutex_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        void (*task_)(void*, std::size_t) = nullptr;
+        void* context_ = nullptr;
+        std::size_t size_ = 0;
+        std::atomic<std::size_t> next_{ 0 };
+        std::size_t busy_ = 0;
+        uint64_t batch_ = 0;
+        bool stop_ = false;
+    };
+
+    // Bulk codecs that spread a large batch of text records over several threads. Each takes
+    // the WorkerPool to run on, nullptr for WorkerPool::Default().
+    struct Parallel
+    {
+        // Chunks smaller than this are not worth a thread.
+        static constexpr std::size_t kMinChunk = 64 << 10;
+        static constexpr std::size_t kMinItems = 4 << 10;
+
+        // Decodes the records in [first, last) into out, in order, in up to `threads` chunks
+        // (0 means one per thread of the pool). The buffer is cut at even offsets and every cut is moved to
+        // the next record start, so each thread owns whole records. A first pass counts the
+        // records of each chunk so the second can decode them straight into their final slots
+        // of out. Returns false when the buffer is malformed; out then holds the records before
+        // the first bad one.
+        static bool Decode(const char* first, const char* last, std::vector<TData>& out, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            auto& workers = nullptr != pool ? *pool : WorkerPool::Default();
+            const auto cuts = Split(first, last, Threads(threads, workers));
+            const auto n = cuts.size() - 1;
+            out.clear();
+            if (1 == n)
+            {
+                for (const char* p = first; p != last; )
+                {
+                    out.emplace_back();
+                    if (nullptr == (p = TData::FromChars(out.back(), p, last)))
+                    {
+                        out.pop_back();
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            std::vector<std::size_t> counts(n + 1, 0), done(n, 0);
+            std::vector<char> whole(n, 0);
+            workers.Run(n, [&](std::size_t i) { whole[i] = Count(cuts[i], cuts[i + 1], counts[i + 1]); });
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                counts[i + 1] += counts[i];
+            }
+
+            out.resize(counts[n]);
+            workers.Run(n, [&](std::size_t i) { done[i] = DecodeRange(cuts[i], cuts[i + 1], out.data() + counts[i], counts[i + 1] - counts[i]); });
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (!whole[i] || counts[i] + done[i] != counts[i + 1])
+                {
+                    out.resize(counts[i] + done[i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool Decode(const str_t& s, std::vector<TData>& out, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            return Decode(s.data(), s.data() + s.size(), out, threads, pool);
+        }
+
+        // Appends the text records of [first, last) to out, byte for byte what ToStr in a loop
+        // writes. Each chunk of values is encoded into its own buffer, then the buffers are
+        // joined onto out, which grows once and is never zero-filled: a ByteBuffer is extended
+        // and the buffers copied in parallel, any other B reserved and appended to in order.
+        template <typename B>
+        static void Encode(const TData* first, const TData* last, B& out, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            auto& workers = nullptr != pool ? *pool : WorkerPool::Default();
+            if (1 == Chunks(last - first, Threads(threads, workers)))
+            {
+                for (; first != last; ++first)
+                {
+                    first->ToStr(out);
+                }
+                return;
+            }
+            std::vector<ByteBuffer> parts;
+            EncodeParts(first, last, parts, Threads(threads, workers), workers);
+            Join(parts, out, workers);
+        }
+
+        template <typename B>
+        static void Encode(const std::vector<TData>& v, B& out, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            Encode(v.data(), v.data() + v.size(), out, threads, pool);
+        }
+
+#ifdef TDATA_HAS_POSIX_IO
+        // Encodes like Encode but hands the per-thread buffers to fd with writev, skipping the
+        // join. Returns false when a write fails.
+        static bool Write(int fd, const TData* first, const TData* last, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            auto& workers = nullptr != pool ? *pool : WorkerPool::Default();
+            std::vector<ByteBuffer> parts;
+            EncodeParts(first, last, parts, Threads(threads, workers), workers);
+            std::vector<iovec> iov;
+            for (auto& part : parts)
+            {
+                if (!part.empty())
+                {
+                    iov.push_back(iovec{ part.data(), part.size() });
+                }
+            }
+            for (std::size_t i = 0; i < iov.size(); )
+            {
+                const auto r = ::writev(fd, &iov[i], static_cast<int>(std::min<std::size_t>(iov.size() - i, IOV_MAX)));
+                if (r < 0)
+                {
+                    if (EINTR == errno)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                // Drops the fully written buffers and trims a partly written one.
+                auto n = static_cast<std::size_t>(r);
+                for (; i < iov.size() && n >= iov[i].iov_len; ++i)
+                {
+                    n -= iov[i].iov_len;
+                }
+                if (0 != n)
+                {
+                    iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + n;
+                    iov[i].iov_len -= n;
+                }
+            }
+            return true;
+        }
+
+        static bool Write(int fd, const std::vector<TData>& v, unsigned threads = 0, WorkerPool* pool = nullptr)
+        {
+            return Write(fd, v.data(), v.data() + v.size(), threads, pool);
+        }
+#endif
+
+        // Start of the first record at or after p. Only an unescaped '$' ends a record, and a
+        // '$' is escaped exactly when an odd run of '\' precedes it, so the cut is found by
+        // looking back over the '\' run before p and scanning forward from there.
+        static const char* NextRecord(const char* first, const char* last, const char* p)
+        {
+            if (p <= first || p >= last)
+            {
+                return p <= first ? first : last;
+            }
+            auto q = p - 1;
+            auto r = q;
+            while (r > first && *(r - 1) == kTransChar)
+            {
+                --r;
+            }
+            if (0 != (q - r) % 2)
+            {
+                ++q;
+            }
+            const auto end = detail::StrCoder::Find(q, last, kEndSepChar);
+            return end == last ? last : end + 1;
+        }
+
+    private:
+        static unsigned Threads(unsigned threads, const WorkerPool& pool)
+        {
+            return 0 != threads ? threads : pool.Size();
+        }
+
+        // Cut points first = c[0] <= ... <= c[n] = last at record boundaries.
+        static std::vector<const char*> Split(const char* first, const char* last, unsigned threads)
+        {
+            const auto size = static_cast<std::size_t>(last - first);
+            const auto n = std::max<std::size_t>(1, std::min<std::size_t>(threads, size / kMinChunk));
+            std::vector<const char*> cuts(1, first);
+            for (std::size_t i = 1; i < n; ++i)
+            {
+                const auto p = NextRecord(first, last, first + size / n * i);
+                if (p > cuts.back() && p < last)
+                {
+                    cuts.push_back(p);
+                }
+            }
+            cuts.push_back(last);
+            return cuts;
+        }
+
+        // How many runs of values an encode of size values is split into.
+        static std::size_t Chunks(std::size_t size, unsigned threads)
+        {
+            return std::max<std::size_t>(1, std::min<std::size_t>(threads, size / kMinItems));
+        }
+
+        // Splits [first, last) into equal runs of values and encodes run i into parts[i].
+        static void EncodeParts(const TData* first, const TData* last, std::vector<ByteBuffer>& parts, unsigned threads, WorkerPool& pool)
+        {
+            const auto size = static_cast<std::size_t>(last - first);
+            const auto n = Chunks(size, threads);
+            parts.resize(n);
+            pool.Run(n, [&](std::size_t i) {
+                for (auto p = first + size * i / n, e = first + size * (i + 1) / n; p != e; ++p)
+                {
+                    p->ToStr(parts[i]);
+                }
+            });
+        }
+
+        // Appends parts to out in order: a ByteBuffer grows uninitialized and each part is
+        // copied to its offset on the pool.
+        static void Join(const std::vector<ByteBuffer>& parts, ByteBuffer& out, WorkerPool& pool)
+        {
+            std::vector<std::size_t> offsets(parts.size() + 1, out.size());
+            for (std::size_t i = 0; i < parts.size(); ++i)
+            {
+                offsets[i + 1] = offsets[i] + parts[i].size();
+            }
+            out.resize(offsets.back());
+            pool.Run(parts.size(), [&](std::size_t i) {
+                if (!parts[i].empty())
+                {
+                    std::memcpy(out.data() + offsets[i], parts[i].data(), parts[i].size());
+                }
+            });
+        }
+
+        template <typename B>
+        static void Join(const std::vector<ByteBuffer>& parts, B& out, WorkerPool&)
+        {
+            auto size = out.size();
+            for (const auto& part : parts)
+            {
+                size += part.size();
+            }
+            out.reserve(size);
+            for (const auto& part : parts)
+            {
+                if (!part.empty())
+                {
+                    out.append(part.data(), part.size());
+                }
+            }
+        }
+
+        // Counts the records that [p, last) starts with; false when something else follows them.
+        static bool Count(const char* p, const char* last, std::size_t& n)
+        {
+            for (; p != last; ++n)
+            {
+                const auto end = detail::StrCoder::CheckTypeAndFindEnd(p, last, detail::StrCoder::GetType(p, last));
+                if (nullptr == end || !detail::StrCoder::IsType(p[1]))
+                {
+                    return false;
+                }
+                p = end + 1;
+            }
+            return true;
+        }
+
+        // Decodes the first n records of [p, last) into out[0, n) and returns how many succeeded.
+        static std::size_t DecodeRange(const char* p, const char* last, TData* out, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (nullptr == (p = TData::FromChars(out[i], p, last)))
+                {
+                    return i;
+                }
+            }
+            return n;
+        }
+
+    };
+}
+
+#endif // !__TDATA_PARALLEL_HPP__
@@ -0,0 +1,227 @@
+#ifndef __TDATA_RECORD_HPP__
+#define __TDATA_RECORD_HPP__
+
+#include "tdata.hpp"
+
+#include <initializer_list>
+
+
+namespace tdata {
+    // The field types of a TRecord. The typed decoders of every field are looked up once here,
+    // so decoding a row calls them in turn instead of switching on each encoded tag. Rows
+    // point at their schema, which must outlive them.
+    class Schema
+    {
+    public:
+        using decode_fn = const char* (*)(TData&, const char*, const char*, MemoryResource*);
+
+        Schema(std::initializer_list<Type> types) : Schema(std::vector<Type>(types)) {}
+
+        explicit Schema(const std::vector<Type>& types)
+        {
+            fields_.reserve(types.size());
+            for (const auto type : types)
+            {
+                fields_.push_back(FieldOf(type));
+            }
+            valid_ = std::none_of(fields_.begin(), fields_.end(), [](const Field& f) { return Type::kUnknown == f.type; });
+        }
+
+        std::size_t Size() const { return fields_.size(); }
+        Type operator[](std::size_t i) const { return fields_[i].type; }
+
+        // Whether every field has one of the six value types; rows of other schemas never decode,
+        // take no values and encode to nothing.
+        bool IsValid() const { return valid_; }
+
+    private:
+        friend class TRecord;
+
+        struct Field
+        {
+            Type type;
+            // Position of the type in Type, for the encoder tables of TRecord.
+            int kind;
+            decode_fn chars;
+            decode_fn binary;
+        };
+
+        static const char* Reject(TData&, const char*, const char*, MemoryResource*) { return nullptr; }
+
+        static Field FieldOf(Type type)
+        {
+            switch (type)
+            {
+            case Type::kInt: return Field{ type, 0, &TData::FromCharsAs<Type::kInt>, &TData::FromBinaryAs<Type::kInt> };
+            case Type::kReal: return Field{ type, 1, &TData::FromCharsAs<Type::kReal>, &TData::FromBinaryAs<Type::kReal> };
+            case Type::kStr: return Field{ type, 2, &TData::FromCharsAs<Type::kStr>, &TData::FromBinaryAs<Type::kStr> };
+            case Type::kVInt: return Field{ type, 3, &TData::FromCharsAs<Type::kVInt>, &TData::FromBinaryAs<Type::kVInt> };
+            case Type::kVReal: return Field{ type, 4, &TData::FromCharsAs<Type::kVReal>, &TData::FromBinaryAs<Type::kVReal> };
+            case Type::kVStr: return Field{ type, 5, &TData::FromCharsAs<Type::kVStr>, &TData::FromBinaryAs<Type::kVStr> };
+            default: return Field{ Type::kUnknown, 0, &Reject, &Reject };
+            }
+        }
+
+    private:
+        std::vector<Field> fields_;
+        bool valid_ = true;
+    };
+
+    // A row of TData fields with the types of a Schema, kept in one array. Its text and binary
+    // forms are the field records back to back, "^i1$^sabc$...". Decoding checks each field's
+    // tag against the schema as it goes, fails at the first field that is malformed or of
+    // another type, and reuses the fields' storage, so a row decoded over and over stops
+    // allocating once its strings and vectors have grown to size.
+    class TRecord
+    {
+    public:
+        // A row of null values of the schema's types; payloads that do not fit inline come from
+        // resource (nullptr for the heap).
+        explicit TRecord(const Schema& schema, MemoryResource* resource = nullptr) : schema_(&schema), resource_(resource), fields_(schema.Size())
+        {
+            for (std::size_t i = 0; i < fields_.size(); ++i)
+            {
+                Reset(fields_[i], schema[i]);
+            }
+        }
+
+        const Schema& GetSchema() const { return *schema_; }
+        std::size_t Size() const { return fields_.size(); }
+        const TData& operator[](std::size_t i) const { return fields_[i]; }
+        const TData* begin() const { return fields_.data(); }
+        const TData* end() const { return fields_.data() + fields_.size(); }
+
+        // Sets field i; false when v is not of the type the schema gives the field.
+        template <typename T>
+        bool Set(std::size_t i, T&& v)
+        {
+            return tdata_traits<T>::enum_value == (*schema_)[i] && fields_[i].SetValue(std::forward<T>(v), resource_);
+        }
+
+        // Empties every field, keeping the types and the capacity.
+        void Clear()
+        {
+            for (auto& f : fields_)
+            {
+                f.Clear();
+            }
+        }
+
+        str_t ToStr() const
+        {
+            str_t str;
+            ToStr(str);
+            return str;
+        }
+
+        // Appends the row to s, any sink TData::ToStr accepts.
+        template <typename S>
+        void ToStr(S& s) const
+        {
+            static const encode_fn<S> kEncoders[] = { &EncodeStr<int_t, S>, &EncodeStr<real_t, S>, &EncodeStr<str_t, S>,
+                                                      &EncodeStr<vint_t, S>, &EncodeStr<vreal_t, S>, &EncodeStr<vstr_t, S> };
+            Encode(kEncoders, s);
+        }
+
+        str_t ToBinary() const
+        {
+            str_t str;
+            ToBinary(str);
+            return str;
+        }
+
+        template <typename S>
+        void ToBinary(S& s) const
+        {
+            static const encode_fn<S> kEncoders[] = { &EncodeBinary<int_t, S>, &EncodeBinary<real_t, S>, &EncodeBinary<str_t, S>,
+                                                      &EncodeBinary<vint_t, S>, &EncodeBinary<vreal_t, S>, &EncodeBinary<vstr_t, S> };
+            Encode(kEncoders, s);
+        }
+
+        static bool FromStr(TRecord& r, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<TRecord>(r, s, p);
+        }
+
+        // Decodes the row that starts at first and returns its end, or nullptr when a field is
+        // missing, malformed or of another type than the schema's. The fields before the bad
+        // one keep their new values and the rest are left as they were or emptied.
+        static const char* FromChars(TRecord& r, const char* first, const char* last)
+        {
+            return r.Decode(first, last, false);
+        }
+
+        static bool FromBinary(TRecord& r, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<TRecord>(r, s, p);
+        }
+
+        static const char* FromBinary(TRecord& r, const char* first, const char* last)
+        {
+            return r.Decode(first, last, true);
+        }
+
+        friend bool operator== (const TRecord& lhs, const TRecord& rhs)
+        {
+            return lhs.fields_.size() == rhs.fields_.size() && std::equal(lhs.fields_.begin(), lhs.fields_.end(), rhs.fields_.begin());
+        }
+        friend bool operator!= (const TRecord& lhs, const TRecord& rhs) { return !(lhs == rhs); }
+
+    private:
+        template <typename S>
+        using encode_fn = void (*)(const TData&, S&);
+
+        template <typename T, typename S>
+        static void EncodeStr(const TData& v, S& s) { tdata_traits<T>::ToStr(v.GetValue<T>(), s); }
+
+        template <typename T, typename S>
+        static void EncodeBinary(const TData& v, S& s) { tdata_traits<T>::ToBinary(v.GetValue<T>(), s); }
+
+        // A field of an invalid schema has no encoder, so such a row writes nothing rather than
+        // bytes of the wrong type.
+        template <typename S>
+        void Encode(const encode_fn<S>* encoders, S& s) const
+        {
+            if (!schema_->IsValid())
+            {
+                return;
+            }
+            const auto& schema = schema_->fields_;
+            for (std::size_t i = 0; i < fields_.size(); ++i)
+            {
+                encoders[schema[i].kind](fields_[i], s);
+            }
+        }
+
+        const char* Decode(const char* p, const char* last, bool binary)
+        {
+            const auto& schema = schema_->fields_;
+            for (std::size_t i = 0; i < fields_.size() && nullptr != p; ++i)
+            {
+                p = (binary ? schema[i].binary : schema[i].chars)(fields_[i], p, last, resource_);
+            }
+            return p;
+        }
+
+        static void Reset(TData& v, Type type)
+        {
+            switch (type)
+            {
+            case Type::kInt: v.SetValue(tdata_traits<int_t>::null_value); break;
+            case Type::kReal: v.SetValue(tdata_traits<real_t>::null_value); break;
+            case Type::kStr: v.SetValue(StrView()); break;
+            case Type::kVInt: v.SetValue(Span<int_t>()); break;
+            case Type::kVReal: v.SetValue(Span<real_t>()); break;
+            case Type::kVStr: v.SetValue(Span<StrView>()); break;
+            default: break;
+            }
+        }
+
+    private:
+        const Schema* schema_;
+        MemoryResource* resource_;
+        std::vector<TData> fields_;
+    };
+}
+
+#endif // !__TDATA_RECORD_HPP__
@@ -0,0 +1,229 @@
+#ifndef __TDATA_SCAN_HPP__
+#define __TDATA_SCAN_HPP__
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TDATA_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(TDATA_HAS_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TDATA_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+
+namespace tdata {
+    namespace detail {
+        // Byte searches over escaped text. An escape char always takes the byte after it with
+        // it, so a delimiter counts only when it is preceded by an even run of escape chars. The
+        // SIMD kernels compare 16 (SSE2) or 32 (AVX2) bytes at once and only walk the hits; the
+        // widest one the CPU supports is chosen on first use.
+        struct Scanner
+        {
+            using find_fn = const char* (*)(const char*, const char*, char, char);
+            using first_of_fn = const char* (*)(const char*, const char*, char, char, char);
+
+            // First delim in [p, last) that is not escaped by esc, or last.
+            static const char* FindUnescaped(const char* p, const char* last, char delim, char esc)
+            {
+                static const find_fn fn = SelectUnescaped();
+                return fn(p, last, delim, esc);
+            }
+
+            // First a, b or c in [p, last), or last.
+            static const char* FindFirstOf(const char* p, const char* last, char a, char b, char c)
+            {
+                static const first_of_fn fn = SelectFirstOf();
+                return fn(p, last, a, b, c);
+            }
+
+            static const char* FindFirstOfScalar(const char* p, const char* last, char a, char b, char c)
+            {
+                for (; p < last; ++p)
+                {
+                    if (*p == a || *p == b || *p == c)
+                    {
+                        return p;
+                    }
+                }
+                return last;
+            }
+
+            static const char* FindUnescapedScalar(const char* p, const char* last, char delim, char esc)
+            {
+                for (; p < last; ++p)
+                {
+                    if (*p == delim)
+                    {
+                        return p;
+                    }
+                    if (*p == esc)
+                    {
+                        ++p;
+                    }
+                }
+                return last;
+            }
+
+#ifdef TDATA_HAS_SSE2
+            static const char* FindUnescapedSse2(const char* p, const char* last, char delim, char esc)
+            {
+                const auto vd = _mm_set1_epi8(delim);
+                const auto ve = _mm_set1_epi8(esc);
+                while (last - p >= 16)
+                {
+                    const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, vd), _mm_cmpeq_epi8(x, ve))));
+                    if (WalkHits(p, mask, 16, delim))
+                    {
+                        return p;
+                    }
+                }
+                return FindUnescapedScalar(p, last, delim, esc);
+            }
+#endif
+
+#ifdef TDATA_HAS_SSE2
+            static const char* FindFirstOfSse2(const char* p, const char* last, char a, char b, char c)
+            {
+                const auto va = _mm_set1_epi8(a);
+                const auto vb = _mm_set1_epi8(b);
+                const auto vc = _mm_set1_epi8(c);
+                for (; last - p >= 16; p += 16)
+                {
+                    const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const auto hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)), _mm_cmpeq_epi8(x, vc));
+                    const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+                    if (0 != mask)
+                    {
+                        return p + LowestBit(mask);
+                    }
+                }
+                return FindFirstOfScalar(p, last, a, b, c);
+            }
+#endif
+
+#ifdef TDATA_HAS_AVX2
+            __attribute__((target("avx2")))
+            static const char* FindFirstOfAvx2(const char* p, const char* last, char a, char b, char c)
+            {
+                const auto va = _mm256_set1_epi8(a);
+                const auto vb = _mm256_set1_epi8(b);
+                const auto vc = _mm256_set1_epi8(c);
+                for (; last - p >= 32; p += 32)
+                {
+                    const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    const auto hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)), _mm256_cmpeq_epi8(x, vc));
+                    const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                    if (0 != mask)
+                    {
+                        return p + LowestBit(mask);
+                    }
+                }
+                return FindFirstOfSse2(p, last, a, b, c);
+            }
+
+            __attribute__((target("avx2")))
+            static const char* FindUnescapedAvx2(const char* p, const char* last, char delim, char esc)
+            {
+                const auto vd = _mm256_set1_epi8(delim);
+                const auto ve = _mm256_set1_epi8(esc);
+                while (last - p >= 32)
+                {
+                    const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, vd), _mm256_cmpeq_epi8(x, ve))));
+                    if (WalkHits(p, mask, 32, delim))
+                    {
+                        return p;
+                    }
+                }
+                return FindUnescapedScalar(p, last, delim, esc);
+            }
+#endif
+
+        private:
+            static bool HasAvx2()
+            {
+#ifdef TDATA_HAS_AVX2
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+#else
+                return false;
+#endif
+            }
+
+            static find_fn SelectUnescaped()
+            {
+#ifdef TDATA_HAS_AVX2
+                if (HasAvx2())
+                {
+                    return FindUnescapedAvx2;
+                }
+#endif
+#ifdef TDATA_HAS_SSE2
+                return FindUnescapedSse2;
+#else
+                return FindUnescapedScalar;
+#endif
+            }
+
+            static first_of_fn SelectFirstOf()
+            {
+#ifdef TDATA_HAS_AVX2
+                if (HasAvx2())
+                {
+                    return FindFirstOfAvx2;
+                }
+#endif
+#ifdef TDATA_HAS_SSE2
+                return FindFirstOfSse2;
+#else
+                return FindFirstOfScalar;
+#endif
+            }
+
+            // Resolves the delimiter/escape hits of the width-byte block at p, lowest first. Returns
+            // true with p on the delimiter, or false with p on the first byte after the block that
+            // an escape has not consumed.
+            static bool WalkHits(const char*& p, unsigned mask, int width, char delim)
+            {
+                while (0 != mask)
+                {
+                    const int i = LowestBit(mask);
+                    if (p[i] == delim)
+                    {
+                        p += i;
+                        return true;
+                    }
+                    const int next = i + 2;
+                    if (next >= width)
+                    {
+                        p += next;
+                        return false;
+                    }
+                    mask &= ~((1u << next) - 1);
+                }
+                p += width;
+                return false;
+            }
+
+            static int LowestBit(unsigned mask)
+            {
+#if defined(__GNUC__) || defined(__clang__)
+                return __builtin_ctz(mask);
+#else
+                int i = 0;
+                for (; 0 == (mask & 1); mask >>= 1)
+                {
+                    ++i;
+                }
+                return i;
+#endif
+            }
+        };
+    }
+}
+
+#endif // !__TDATA_SCAN_HPP__
@@ -0,0 +1,176 @@
+#ifndef __TDATA_SORT_HPP__
+#define __TDATA_SORT_HPP__
+
+#include "tdata.hpp"
+
+
+namespace tdata {
+    namespace detail {
+        // LSD radix sort of 64-bit keys whose unsigned order is the order of the values:
+        // int_t with the sign bit flipped, real_t with the IEEE bits of negatives inverted.
+        struct RadixSorter
+        {
+            // Below this a run is cheaper to std::sort than to count.
+            enum { kMinRadix = 256 };
+
+            static uint64_t IntKey(int_t v) { return static_cast<uint64_t>(v) ^ kSign; }
+            static int_t FromIntKey(uint64_t k) { return static_cast<int_t>(k ^ kSign); }
+
+            static uint64_t RealKey(real_t v)
+            {
+                uint64_t w;
+                std::memcpy(&w, &v, 8);
+                return 0 != (w & kSign) ? ~w : w | kSign;
+            }
+
+            static real_t FromRealKey(uint64_t k)
+            {
+                const uint64_t w = 0 != (k & kSign) ? k & ~kSign : ~k;
+                real_t v;
+                std::memcpy(&v, &w, 8);
+                return v;
+            }
+
+            // Sorts keys[0, n) with one counting pass and up to eight scatter passes of a byte
+            // each, skipping bytes that every key shares.
+            static void Sort(uint64_t* keys, std::size_t n, std::vector<uint64_t>& tmp)
+            {
+                if (n < kMinRadix)
+                {
+                    std::sort(keys, keys + n);
+                    return;
+                }
+                std::vector<std::size_t> counts(8 * 256, 0);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const auto k = keys[i];
+                    for (int b = 0; b < 8; ++b)
+                    {
+                        ++counts[b * 256 + ((k >> (8 * b)) & 0xff)];
+                    }
+                }
+                tmp.resize(n);
+                auto src = keys;
+                auto dst = tmp.data();
+                for (int b = 0; b < 8; ++b)
+                {
+                    const auto count = counts.data() + b * 256;
+                    const int shift = 8 * b;
+                    if (count[(keys[0] >> shift) & 0xff] == n)
+                    {
+                        continue;
+                    }
+                    std::size_t sum = 0;
+                    for (int d = 0; d < 256; ++d)
+                    {
+                        const auto c = count[d];
+                        count[d] = sum;
+                        sum += c;
+                    }
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        const auto k = src[i];
+                        dst[count[(k >> shift) & 0xff]++] = k;
+                    }
+                    std::swap(src, dst);
+                }
+                if (src != keys)
+                {
+                    std::memcpy(keys, src, n * sizeof(uint64_t));
+                }
+            }
+
+        private:
+            enum : uint64_t { kSign = 0x8000000000000000ULL };
+        };
+
+        // Sorts a run of one type with that type's compare, skipping the dispatch of operator<.
+        template <typename T>
+        void SortAs(TData* first, TData* last)
+        {
+            std::sort(first, last, [](const TData& lhs, const TData& rhs) {
+                return TotalOrder::Compare(lhs.GetValue<T>(), rhs.GetValue<T>()) < 0;
+            });
+        }
+    }
+
+    // Sorts [first, last) by operator<. Values are grouped by type first; kInt and kReal runs
+    // are radix sorted on their numbers and written back, and the other types go to std::sort.
+    inline void Sort(TData* first, TData* last)
+    {
+        using detail::TotalOrder;
+        const auto n = static_cast<std::size_t>(last - first);
+        std::size_t starts[8] = {};
+        bool grouped_already = true;
+        for (auto p = first; p != last; ++p)
+        {
+            const int r = TotalOrder::Rank(p->GetType());
+            grouped_already = grouped_already && (p == first || TotalOrder::Rank(p[-1].GetType()) <= r);
+            ++starts[r + 1];
+        }
+        for (int r = 1; r < 8; ++r)
+        {
+            starts[r] += starts[r - 1];
+        }
+        if (!grouped_already)
+        {
+            std::vector<TData> grouped(n);
+            std::size_t next[7];
+            std::copy(starts, starts + 7, next);
+            for (auto p = first; p != last; ++p)
+            {
+                grouped[next[TotalOrder::Rank(p->GetType())]++] = std::move(*p);
+            }
+            std::move(grouped.begin(), grouped.end(), first);
+        }
+
+        std::vector<uint64_t> keys, tmp;
+        for (int r = 1; r < 7; ++r)
+        {
+            auto b = first + starts[r];
+            auto e = first + starts[r + 1];
+            if (e - b < 2)
+            {
+                continue;
+            }
+            switch (b->GetType())
+            {
+            case Type::kInt:
+                keys.clear();
+                for (auto p = b; p != e; ++p)
+                {
+                    keys.push_back(detail::RadixSorter::IntKey(p->GetValue<int_t>()));
+                }
+                detail::RadixSorter::Sort(keys.data(), keys.size(), tmp);
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                {
+                    b[i].SetValue(detail::RadixSorter::FromIntKey(keys[i]));
+                }
+                break;
+            case Type::kReal:
+                // NaNs are all equivalent and go last.
+                e = std::partition(b, e, [](const TData& v) { return v.GetValue<real_t>() == v.GetValue<real_t>(); });
+                keys.clear();
+                for (auto p = b; p != e; ++p)
+                {
+                    keys.push_back(detail::RadixSorter::RealKey(p->GetValue<real_t>()));
+                }
+                detail::RadixSorter::Sort(keys.data(), keys.size(), tmp);
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                {
+                    b[i].SetValue(detail::RadixSorter::FromRealKey(keys[i]));
+                }
+                break;
+            case Type::kStr: detail::SortAs<str_t>(b, e); break;
+            case Type::kVInt: detail::SortAs<vint_t>(b, e); break;
+            case Type::kVReal: detail::SortAs<vreal_t>(b, e); break;
+            case Type::kVStr: detail::SortAs<vstr_t>(b, e); break;
+            default: break;
+            }
+        }
+    }
+
+    inline void Sort(std::vector<TData>& values) { Sort(values.data(), values.data() + values.size()); }
+}
+
+#endif // !__TDATA_SORT_HPP__
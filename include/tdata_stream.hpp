@@ -0,0 +1,327 @@
+#ifndef __TDATA_STREAM_HPP__
+#define __TDATA_STREAM_HPP__
+
+#include "tdata.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <ostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TDATA_HAS_POSIX_IO
+#include <unistd.h>
+#endif
+
+
+namespace tdata {
+    // Push-style decoder for text records that arrive in arbitrary chunks, e.g. socket or pipe
+    // reads. Records that lie wholly inside a chunk are decoded in place; only the tail of a
+    // record cut by a chunk boundary is copied aside, together with whether it ended on an open
+    // '\' escape, so the search for record ends covers each byte once however the input is
+    // split. Each completed record is decoded by TData::FromRecord from the '$' that search
+    // found, without scanning it again, into a new TData, as f takes ownership of the value.
+    class StreamDecoder
+    {
+    public:
+        using size_type = str_t::size_type;
+
+        // Longest record the pending buffer grows to by default.
+        static constexpr size_type kDefaultMaxRecord = 64 << 20;
+
+        // A record longer than max_record bytes fails the stream; 0 lifts the limit, leaving the
+        // pending buffer free to grow as long as the input does.
+        explicit StreamDecoder(size_type max_record = kDefaultMaxRecord) : max_record_(max_record) {}
+
+        // Decodes the records completed by [p, p + n) and calls f(TData&&) on each, in order.
+        // Returns false once the input is malformed; records before the error are still passed
+        // to f, and every later call fails until Reset.
+        template <typename F>
+        bool Feed(const char* p, size_type n, F&& f)
+        {
+            const auto last = p + n;
+            while (!failed_ && p < last)
+            {
+                p = pending_.empty() ? FeedWhole(p, last, f) : FeedPending(p, last, f);
+            }
+            return !failed_;
+        }
+
+        template <typename F>
+        bool Feed(const str_t& s, F&& f)
+        {
+            return Feed(s.data(), s.size(), f);
+        }
+
+        bool Failed() const { return failed_; }
+        // Bytes of a record that has begun but not yet ended.
+        size_type Pending() const { return pending_.size(); }
+
+        // Drops any partial record and clears the error, keeping the buffer capacity.
+        void Reset()
+        {
+            pending_.clear();
+            escaped_ = false;
+            failed_ = false;
+        }
+
+    private:
+        // At a record boundary: decodes every record that ends inside [p, last) and stashes the
+        // unfinished tail.
+        template <typename F>
+        const char* FeedWhole(const char* p, const char* last, F& f)
+        {
+            if (*p != kBegSepChar)
+            {
+                return Fail(last);
+            }
+            if (last - p < 2)
+            {
+                return Stash(p, last, p);
+            }
+            if (!detail::StrCoder::IsType(p[1]))
+            {
+                return Fail(last);
+            }
+            const auto end = detail::StrCoder::Find(p + 2, last, kEndSepChar);
+            if (end == last)
+            {
+                return Stash(p, last, p + 2);
+            }
+            if (0 != max_record_ && static_cast<size_type>(end + 1 - p) > max_record_)
+            {
+                return Fail(last);
+            }
+            return Emit(p, end, f) ? end + 1 : Fail(last);
+        }
+
+        // Inside a record: continues it with [p, last).
+        template <typename F>
+        const char* FeedPending(const char* p, const char* last, F& f)
+        {
+            if (pending_.size() < 2)
+            {
+                if (!detail::StrCoder::IsType(*p))
+                {
+                    return Fail(last);
+                }
+                pending_.push_back(*p);
+                return p + 1;
+            }
+            const auto scan = escaped_ ? p + 1 : p;
+            const auto end = detail::StrCoder::Find(scan, last, kEndSepChar);
+            if (end == last)
+            {
+                return Stash(p, last, scan);
+            }
+            if (0 != max_record_ && pending_.size() + (end + 1 - p) > max_record_)
+            {
+                return Fail(last);
+            }
+            pending_.append(p, end + 1 - p);
+            if (!Emit(pending_.data(), pending_.data() + pending_.size() - 1, f))
+            {
+                return Fail(last);
+            }
+            pending_.clear();
+            escaped_ = false;
+            return end + 1;
+        }
+
+        // Decodes the record [first, end], end being its '$'.
+        template <typename F>
+        bool Emit(const char* first, const char* end, F& f)
+        {
+            TData v;
+            if (nullptr == TData::FromRecord(v, first, end))
+            {
+                return false;
+            }
+            f(std::move(v));
+            return true;
+        }
+
+        // Keeps [p, last) as the start of a record. scan is where escape tracking starts afresh;
+        // the tail is left on an open escape when it ends in an odd run of '\'.
+        const char* Stash(const char* p, const char* last, const char* scan)
+        {
+            if (0 != max_record_ && pending_.size() + (last - p) > max_record_)
+            {
+                return Fail(last);
+            }
+            pending_.append(p, last - p);
+            auto q = last;
+            while (q > scan && *(q - 1) == kTransChar)
+            {
+                --q;
+            }
+            escaped_ = 0 != (last - q) % 2;
+            return last;
+        }
+
+        const char* Fail(const char* last)
+        {
+            failed_ = true;
+            return last;
+        }
+
+    private:
+        size_type max_record_ = 0;
+        str_t pending_;
+        bool escaped_ = false;
+        bool failed_ = false;
+    };
+
+    // Byte sinks for BasicStreamWriter: Write hands over all n bytes or returns false.
+#ifdef TDATA_HAS_POSIX_IO
+    struct FdSink
+    {
+        FdSink(int fd) : fd_(fd) {}
+
+        bool Write(const char* p, std::size_t n)
+        {
+            while (0 != n)
+            {
+                const auto r = ::write(fd_, p, n);
+                if (r < 0)
+                {
+                    if (EINTR == errno)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                p += r;
+                n -= static_cast<std::size_t>(r);
+            }
+            return true;
+        }
+
+    private:
+        int fd_;
+    };
+#endif
+
+    struct FileSink
+    {
+        FileSink(std::FILE* file) : file_(file) {}
+
+        bool Write(const char* p, std::size_t n) { return std::fwrite(p, 1, n, file_) == n; }
+
+    private:
+        std::FILE* file_;
+    };
+
+    struct OStreamSink
+    {
+        OStreamSink(std::ostream& os) : os_(&os) {}
+
+        bool Write(const char* p, std::size_t n) { return static_cast<bool>(os_->write(p, static_cast<std::streamsize>(n))); }
+
+    private:
+        std::ostream* os_;
+    };
+
+    // Encodes values straight into one fixed-size buffer and hands it to the sink whenever it
+    // fills, so a long dump builds no per-record string and makes one write per buffer. A
+    // record larger than the buffer grows it once instead of being split. The destructor
+    // flushes; call Flush to see whether that succeeded.
+    template <typename Sink>
+    class BasicStreamWriter
+    {
+    public:
+        using sink_type = Sink;
+        using size_type = ByteBuffer::size_type;
+
+        static constexpr size_type kDefaultBufferSize = 64 << 10;
+
+        explicit BasicStreamWriter(sink_type sink, size_type buffer_size = kDefaultBufferSize)
+            : sink_(sink), limit_(0 != buffer_size ? buffer_size : 1)
+        {
+            buf_.reserve(limit_);
+        }
+        BasicStreamWriter(const BasicStreamWriter&) = delete;
+        BasicStreamWriter& operator= (const BasicStreamWriter&) = delete;
+        ~BasicStreamWriter() { Flush(); }
+
+        // Text records, as ToStr writes them.
+        BasicStreamWriter& Write(const TData& v)
+        {
+            v.ToStr(buf_);
+            return Commit();
+        }
+
+        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
+        BasicStreamWriter& Write(const T& v)
+        {
+            tdata_traits<T>::ToStr(v, buf_);
+            return Commit();
+        }
+
+        // Binary records, as ToBinary writes them.
+        BasicStreamWriter& WriteBinary(const TData& v)
+        {
+            v.ToBinary(buf_);
+            return Commit();
+        }
+
+        template <typename T, typename = typename std::enable_if<tdata_traits<T>::value>::type>
+        BasicStreamWriter& WriteBinary(const T& v)
+        {
+            tdata_traits<T>::ToBinary(v, buf_);
+            return Commit();
+        }
+
+        // Any other encoding: f(ByteBuffer&) appends whole records to the buffer.
+        template <typename F>
+        BasicStreamWriter& Encode(F&& f)
+        {
+            f(buf_);
+            return Commit();
+        }
+
+        // Writes out the buffered bytes; false when this or an earlier write to the sink failed,
+        // in which case the bytes are dropped and not counted by Written.
+        bool Flush()
+        {
+            if (!failed_ && !buf_.empty())
+            {
+                failed_ = !sink_.Write(buf_.data(), buf_.size());
+                if (!failed_)
+                {
+                    written_ += buf_.size();
+                }
+            }
+            buf_.clear();
+            return !failed_;
+        }
+
+        bool Failed() const { return failed_; }
+        // Bytes the sink has accepted so far.
+        size_type Written() const { return written_; }
+
+    private:
+        BasicStreamWriter& Commit()
+        {
+            if (buf_.size() >= limit_)
+            {
+                Flush();
+            }
+            return *this;
+        }
+
+    private:
+        sink_type sink_;
+        size_type limit_;
+        size_type written_ = 0;
+        bool failed_ = false;
+        ByteBuffer buf_;
+    };
+
+#ifdef TDATA_HAS_POSIX_IO
+    using FdWriter = BasicStreamWriter<FdSink>;
+#endif
+    using FileWriter = BasicStreamWriter<FileSink>;
+    using OStreamWriter = BasicStreamWriter<OStreamSink>;
+}
+
+#endif // !__TDATA_STREAM_HPP__
@@ -0,0 +1,206 @@
+#ifndef __TDATA_STRUCT_HPP__
+#define __TDATA_STRUCT_HPP__
+
+#include "tdata.hpp"
+
+
+namespace tdata {
+    // Specialized by TDATA_STRUCT for a struct whose members all have tdata_traits.
+    template <typename T>
+    struct struct_traits : std::false_type {};
+
+    // Encodes and decodes a TDATA_STRUCT struct as its members' records back to back: the bytes
+    // that boxing each member in a TData and calling ToStr / ToBinary gives, which is also the
+    // row format of TRecord. Each member goes straight through its tdata_traits with no TData
+    // in between, and decoding stops at the first member that is malformed, of another type or
+    // out of the member's range.
+    struct StructCoder
+    {
+        template <typename T>
+        static str_t ToStr(const T& v)
+        {
+            str_t str;
+            ToStr(v, str);
+            return str;
+        }
+
+        // Appends the struct to s, any sink TData::ToStr accepts.
+        template <typename T, typename S>
+        static void ToStr(const T& v, S& s)
+        {
+            Encoder<S, false> f{ s };
+            struct_traits<T>::ForEach(v, f);
+        }
+
+        template <typename T>
+        static str_t ToBinary(const T& v)
+        {
+            str_t str;
+            ToBinary(v, str);
+            return str;
+        }
+
+        template <typename T, typename S>
+        static void ToBinary(const T& v, S& s)
+        {
+            Encoder<S, true> f{ s };
+            struct_traits<T>::ForEach(v, f);
+        }
+
+        template <typename T>
+        static bool FromStr(T& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<StructCoder>(v, s, p);
+        }
+
+        // Decodes the struct that starts at first and returns its end, or nullptr on failure;
+        // the members before the bad one keep their new values.
+        template <typename T>
+        static const char* FromChars(T& v, const char* first, const char* last)
+        {
+            Decoder<false> f{ first, last };
+            return struct_traits<T>::ForEach(v, f) ? f.p : nullptr;
+        }
+
+        template <typename T>
+        static bool FromBinary(T& v, const str_t& s, str_t::size_type* p = nullptr)
+        {
+            return detail::BinCoder::FromBinary<StructCoder>(v, s, p);
+        }
+
+        template <typename T>
+        static const char* FromBinary(T& v, const char* first, const char* last)
+        {
+            Decoder<true> f{ first, last };
+            return struct_traits<T>::ForEach(v, f) ? f.p : nullptr;
+        }
+
+    private:
+        template <typename S, bool binary>
+        struct Encoder
+        {
+            S& s;
+
+            template <typename M>
+            bool operator()(const M& m) const
+            {
+                binary ? tdata_traits<M>::ToBinary(m, s) : tdata_traits<M>::ToStr(m, s);
+                return true;
+            }
+        };
+
+        template <bool binary>
+        struct Decoder
+        {
+            const char* p;
+            const char* last;
+
+            template <typename M>
+            bool operator()(M& m)
+            {
+                Reset(m);
+                p = Read(m, p, last, std::is_same<M, typename tdata_traits<M>::value_type>());
+                return nullptr != p;
+            }
+
+            // The vector decoders append, so vector members are emptied first; their capacity
+            // is kept for the next struct.
+            template <typename E>
+            static void Reset(std::vector<E>& m) { m.clear(); }
+
+            template <typename M>
+            static void Reset(M&) {}
+
+            // Members of the wire type are decoded in place, narrower ones through it.
+            template <typename M>
+            static const char* Read(M& m, const char* first, const char* last, std::true_type)
+            {
+                return binary ? tdata_traits<M>::FromBinary(m, first, last) : tdata_traits<M>::FromChars(m, first, last);
+            }
+
+            template <typename M>
+            static const char* Read(M& m, const char* first, const char* last, std::false_type)
+            {
+                typename tdata_traits<M>::value_type v;
+                const auto end = Read(v, first, last, std::true_type());
+                if (nullptr == end || !Fits<M>(v))
+                {
+                    return nullptr;
+                }
+                m = static_cast<M>(v);
+                return end;
+            }
+
+            // Whether a decoded number is in the range of a narrower member: bool takes 0 and 1,
+            // smaller integers their own range, and integers as wide as int_t any value, as a
+            // uint64_t goes through int_t as its bits. A float takes any value up to its largest
+            // finite one, infinities and NaN, rounded to its precision.
+            template <typename M>
+            static bool Fits(int_t v)
+            {
+                return std::is_same<M, bool>::value ? 0 == v || 1 == v
+                    : sizeof(M) >= sizeof(int_t) || (v >= static_cast<int_t>(std::numeric_limits<M>::min()) && v <= static_cast<int_t>(std::numeric_limits<M>::max()));
+            }
+
+            template <typename M>
+            static bool Fits(real_t v)
+            {
+                const auto a = v < 0 ? -v : v;
+                return !(a > std::numeric_limits<M>::max()) || a == std::numeric_limits<real_t>::infinity();
+            }
+        };
+    };
+}
+
+// Declares the members of struct T, in wire order, for StructCoder; use it at global scope
+// after T, listing up to 24 members:
+//
+//     struct Quote { std::string sym; double bid; double ask; };
+//     TDATA_STRUCT(Quote, sym, bid, ask)
+#define TDATA_STRUCT(T, ...)                                                                    \
+    namespace tdata {                                                                           \
+        template <>                                                                             \
+        struct struct_traits<T> : std::true_type                                                \
+        {                                                                                       \
+            template <typename V, typename F>                                                   \
+            static bool ForEach(V& v, F& f)                                                     \
+            {                                                                                   \
+                return TDATA_PP_FOR_EACH(TDATA_PP_STRUCT_FIELD, __VA_ARGS__) true;              \
+            }                                                                                   \
+        };                                                                                      \
+    }
+
+#define TDATA_PP_STRUCT_FIELD(m) f(v.m) &&
+
+#define TDATA_PP_EXPAND(x) x
+#define TDATA_PP_CAT(a, b) TDATA_PP_CAT_I(a, b)
+#define TDATA_PP_CAT_I(a, b) a ## b
+#define TDATA_PP_NARGS(...) TDATA_PP_EXPAND(TDATA_PP_NARGS_I(__VA_ARGS__, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define TDATA_PP_NARGS_I(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, n, ...) n
+#define TDATA_PP_FOR_EACH(m, ...) TDATA_PP_EXPAND(TDATA_PP_CAT(TDATA_PP_FOR_EACH_, TDATA_PP_NARGS(__VA_ARGS__))(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_1(m, x) m(x)
+#define TDATA_PP_FOR_EACH_2(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_1(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_3(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_2(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_4(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_3(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_5(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_4(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_6(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_5(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_7(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_6(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_8(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_7(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_9(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_8(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_10(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_9(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_11(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_10(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_12(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_11(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_13(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_12(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_14(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_13(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_15(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_14(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_16(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_15(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_17(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_16(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_18(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_17(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_19(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_18(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_20(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_19(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_21(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_20(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_22(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_21(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_23(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_22(m, __VA_ARGS__))
+#define TDATA_PP_FOR_EACH_24(m, x, ...) m(x) TDATA_PP_EXPAND(TDATA_PP_FOR_EACH_23(m, __VA_ARGS__))
+
+#endif // !__TDATA_STRUCT_HPP__
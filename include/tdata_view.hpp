@@ -0,0 +1,191 @@
+#ifndef __TDATA_VIEW_HPP__
+#define __TDATA_VIEW_HPP__
+
+#include "tdata.hpp"
+
+
+namespace tdata {
+    // Non-owning view of one encoded record "^t...$" in a caller's buffer, for looking at a
+    // record without materializing it. Binding only finds the end of the record and reads the
+    // element count; numbers are parsed when asked for and escape-free strings are handed out
+    // as StrView into the buffer. The buffer must outlive the view.
+    class TDataView
+    {
+    public:
+        using size_type = str_t::size_type;
+
+        TDataView() = default;
+
+        static bool FromStr(TDataView& v, const str_t& s, size_type* p = nullptr)
+        {
+            return detail::StrCoder::FromStr<TDataView>(v, s, p);
+        }
+
+        // Binds v to the record that starts at first and returns its end, or nullptr on failure.
+        // A vector's element count is checked against the record as TData decoding does, so a
+        // count that is negative or that the record cannot hold fails here.
+        static const char* FromChars(TDataView& v, const char* first, const char* last)
+        {
+            const auto type = detail::StrCoder::GetType(first, last);
+            const char* end = nullptr;
+            const char* p = nullptr;
+            std::size_t size = 1;
+            switch (type)
+            {
+            case Type::kInt:
+            case Type::kReal:
+            case Type::kStr:
+                end = detail::StrCoder::CheckTypeAndFindEnd(first, last, type);
+                break;
+            case Type::kVInt:
+            case Type::kVReal:
+                end = detail::StrCoder::CheckTypeAndReadCount(first, last, type, 2, size, p);
+                break;
+            case Type::kVStr:
+                end = detail::StrCoder::CheckTypeAndReadCount(first, last, type, 1, size, p);
+                break;
+            default:
+                break;
+            }
+            if (nullptr == end)
+            {
+                return nullptr;
+            }
+
+            v.type_ = type;
+            v.text_ = StrView(first, end + 1 - first);
+            v.size_ = size;
+            v.escaped_ = false;
+            if (Type::kStr == type || Type::kVStr == type)
+            {
+                v.escaped_ = detail::StrCoder::FindEscape(first + 2, end) != end;
+            }
+            return end + 1;
+        }
+
+        Type GetType() const { return type_; }
+        // Element count of a vector, 1 for a scalar.
+        size_type Size() const { return size_; }
+        // Whether a kStr / kVStr payload contains escapes, i.e. GetStr cannot serve it in place.
+        bool IsEscaped() const { return escaped_; }
+        // The whole record, "^t...$".
+        StrView GetText() const { return text_; }
+        // The encoded value between the type tag and '$'.
+        StrView GetPayload() const { return text_.empty() ? StrView() : StrView(text_.data() + 2, text_.size() - 3); }
+
+        // Decodes the value; null_value when the type differs.
+        template <typename T>
+        typename tdata_traits<T>::value_type GetValue() const
+        {
+            typename tdata_traits<T>::value_type v = tdata_traits<T>::null_value;
+            if (GetType() == tdata_traits<T>::enum_value)
+            {
+                tdata_traits<T>::FromChars(v, text_.begin(), text_.end());
+            }
+            return v;
+        }
+
+        // An escape-free kStr in place; false for other types or escaped strings.
+        bool GetStr(StrView& v) const
+        {
+            if (Type::kStr != GetType() || IsEscaped())
+            {
+                return false;
+            }
+            v = GetPayload();
+            return true;
+        }
+
+        // Calls f on each element of a kVInt (int_t), kVReal (real_t) or kVStr (StrView) in
+        // order, T being vint_t, vreal_t or vstr_t. Escaped kVStr elements are unescaped into one
+        // reused buffer, so a StrView passed to f is only valid during the call. Returns false
+        // when the type differs or the payload is malformed.
+        template <typename T, typename F>
+        bool ForEach(F&& f) const
+        {
+            return GetType() == tdata_traits<T>::enum_value && ForEachElement(static_cast<const T*>(nullptr), f);
+        }
+
+        // Materializes the record into v.
+        bool ToTData(TData& v) const
+        {
+            return nullptr != TData::FromChars(v, text_.begin(), text_.end());
+        }
+
+    private:
+        template <typename F>
+        bool ForEachElement(const vint_t*, F& f) const
+        {
+            return ForEachNumber<int_t, detail::IntParser>(f);
+        }
+
+        template <typename F>
+        bool ForEachElement(const vreal_t*, F& f) const
+        {
+            return ForEachNumber<real_t, detail::FloatParser>(f);
+        }
+
+        template <typename F>
+        bool ForEachElement(const vstr_t*, F& f) const
+        {
+            const auto payload = GetPayload();
+            const auto end = payload.end();
+            auto p = NextField(payload.begin(), end);
+            str_t buf;
+            for (size_type i = 0; i < size_; ++i)
+            {
+                if (p >= end || *p != kFieldSepChar)
+                {
+                    return false;
+                }
+                const auto next = detail::StrCoder::Find(++p, end, kFieldSepChar);
+                if (IsEscaped() && detail::StrCoder::FindEscape(p, next) != next)
+                {
+                    buf.clear();
+                    detail::StrCoder::Decode(p, next, buf);
+                    f(StrView(buf));
+                }
+                else
+                {
+                    f(StrView(p, next - p));
+                }
+                p = next;
+            }
+            return true;
+        }
+
+        template <typename N, typename Parser, typename F>
+        bool ForEachNumber(F& f) const
+        {
+            const auto payload = GetPayload();
+            const auto end = payload.end();
+            auto p = NextField(payload.begin(), end);
+            for (size_type i = 0; i < size_; ++i)
+            {
+                if (p >= end || *p != kFieldSepChar)
+                {
+                    return false;
+                }
+                N n = 0;
+                p = Parser::FromChars(p + 1, end, n);
+                f(n);
+            }
+            return true;
+        }
+
+        // Skips the element count at the start of a vector payload.
+        static const char* NextField(const char* p, const char* end)
+        {
+            int_t size = 0;
+            return detail::IntParser::FromChars(p, end, size);
+        }
+
+    private:
+        Type type_ = Type::kUnknown;
+        size_type size_ = 0;
+        bool escaped_ = false;
+        StrView text_;
+    };
+}
+
+#endif // !__TDATA_VIEW_HPP__
@@ -138,11 +138,7 @@ inline void swap(recursive_wrapper<T>& lhs, recursive_wrapper<T>& rhs) noexcept
 #  define VARIANT_INLINE //__declspec(noinline)
 # endif
 #else
-# ifdef NDEBUG
-#  define VARIANT_INLINE //inline __attribute__((always_inline))
-# else
-#  define VARIANT_INLINE __attribute__((noinline))
-# endif
+#  define VARIANT_INLINE inline
 #endif
 // clang-format on
 
@@ -289,57 +285,59 @@ struct static_max<arg1, arg2, others...>
     static const std::size_t value = arg1 >= arg2 ? static_max<arg1, others...>::value : static_max<arg2, others...>::value;
 };
 
+// copy, move and destroy index a table of one function per alternative, in the order of
+// Types, instead of testing the alternatives one by one. type_index counts from the back, so
+// the alternative at position sizeof...(Types) - 1 - type_index is the active one; an invalid
+// index is ignored.
 template <typename... Types>
-struct variant_helper;
-
-template <typename T, typename... Types>
-struct variant_helper<T, Types...>
+struct variant_helper
 {
+    template <typename T>
+    static void destroy_as(void* data)
+    {
+        reinterpret_cast<T*>(data)->~T();
+    }
+
+    template <typename T>
+    static void move_as(void* old_value, void* new_value)
+    {
+        new (new_value) T(std::move(*reinterpret_cast<T*>(old_value)));
+    }
+
+    template <typename T>
+    static void copy_as(const void* old_value, void* new_value)
+    {
+        new (new_value) T(*reinterpret_cast<const T*>(old_value));
+    }
+
     VARIANT_INLINE static void destroy(const std::size_t type_index, void* data)
     {
-        if (type_index == sizeof...(Types))
-        {
-            reinterpret_cast<T*>(data)->~T();
-        }
-        else
+        static constexpr void (*table[])(void*) = { &destroy_as<Types>... };
+        if (type_index < sizeof...(Types))
         {
-            variant_helper<Types...>::destroy(type_index, data);
+            table[sizeof...(Types) - 1 - type_index](data);
         }
     }
 
     VARIANT_INLINE static void move(const std::size_t old_type_index, void* old_value, void* new_value)
     {
-        if (old_type_index == sizeof...(Types))
-        {
-            new (new_value) T(std::move(*reinterpret_cast<T*>(old_value)));
-        }
-        else
+        static constexpr void (*table[])(void*, void*) = { &move_as<Types>... };
+        if (old_type_index < sizeof...(Types))
         {
-            variant_helper<Types...>::move(old_type_index, old_value, new_value);
+            table[sizeof...(Types) - 1 - old_type_index](old_value, new_value);
         }
     }
 
     VARIANT_INLINE static void copy(const std::size_t old_type_index, const void* old_value, void* new_value)
     {
-        if (old_type_index == sizeof...(Types))
+        static constexpr void (*table[])(const void*, void*) = { &copy_as<Types>... };
+        if (old_type_index < sizeof...(Types))
         {
-            new (new_value) T(*reinterpret_cast<const T*>(old_value));
-        }
-        else
-        {
-            variant_helper<Types...>::copy(old_type_index, old_value, new_value);
+            table[sizeof...(Types) - 1 - old_type_index](old_value, new_value);
         }
     }
 };
 
-template <>
-struct variant_helper<>
-{
-    VARIANT_INLINE static void destroy(const std::size_t, void*) {}
-    VARIANT_INLINE static void move(const std::size_t, void*, void*) {}
-    VARIANT_INLINE static void copy(const std::size_t, const void*, void*) {}
-};
-
 template <typename T>
 struct unwrapper
 {
@@ -377,48 +375,91 @@ struct unwrapper<std::reference_wrapper<T>>
     }
 };
 
+// Unary visitation: a switch on which() covers the first eight alternatives, so compilers
+// emit one jump table with the visitor calls inlined; any further ones are tested in turn.
+// Positions past the last alternative are never reached and reuse it to stay well-formed.
 template <typename F, typename V, typename R, typename... Types>
-struct dispatcher;
-
-template <typename F, typename V, typename R, typename T, typename... Types>
-struct dispatcher<F, V, R, T, Types...>
+struct dispatcher
 {
-    VARIANT_INLINE static R apply_const(V const& v, F&& f)
+    template <std::size_t I>
+    using alternative = typename std::tuple_element<(I < sizeof...(Types) ? I : sizeof...(Types) - 1), std::tuple<Types...>>::type;
+
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_const_at(V const& v, F&& f)
     {
-        if (v.template is<T>())
-        {
-            return f(unwrapper<T>::apply_const(v.template get_unchecked<T>()));
-        }
-        else
-        {
-            return dispatcher<F, V, R, Types...>::apply_const(v, std::forward<F>(f));
-        }
+        return f(unwrapper<alternative<I>>::apply_const(v.template get_unchecked<alternative<I>>()));
     }
 
-    VARIANT_INLINE static R apply(V& v, F&& f)
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_at(V& v, F&& f)
+    {
+        return f(unwrapper<alternative<I>>::apply(v.template get_unchecked<alternative<I>>()));
+    }
+
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_const_from(V const& v, F&& f, int, std::false_type)
+    {
+        return apply_const_at<I>(v, std::forward<F>(f));
+    }
+
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_const_from(V const& v, F&& f, int which, std::true_type)
     {
-        if (v.template is<T>())
+        if (which == static_cast<int>(I))
         {
-            return f(unwrapper<T>::apply(v.template get_unchecked<T>()));
+            return apply_const_at<I>(v, std::forward<F>(f));
         }
-        else
+        return apply_const_from<I + 1>(v, std::forward<F>(f), which, std::integral_constant<bool, (I + 2 < sizeof...(Types))>());
+    }
+
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_from(V& v, F&& f, int, std::false_type)
+    {
+        return apply_at<I>(v, std::forward<F>(f));
+    }
+
+    template <std::size_t I>
+    VARIANT_INLINE static R apply_from(V& v, F&& f, int which, std::true_type)
+    {
+        if (which == static_cast<int>(I))
         {
-            return dispatcher<F, V, R, Types...>::apply(v, std::forward<F>(f));
+            return apply_at<I>(v, std::forward<F>(f));
         }
+        return apply_from<I + 1>(v, std::forward<F>(f), which, std::integral_constant<bool, (I + 2 < sizeof...(Types))>());
     }
-};
 
-template <typename F, typename V, typename R, typename T>
-struct dispatcher<F, V, R, T>
-{
     VARIANT_INLINE static R apply_const(V const& v, F&& f)
     {
-        return f(unwrapper<T>::apply_const(v.template get_unchecked<T>()));
+        const int which = v.which();
+        switch (which)
+        {
+        case 0: return apply_const_at<0>(v, std::forward<F>(f));
+        case 1: return apply_const_at<1>(v, std::forward<F>(f));
+        case 2: return apply_const_at<2>(v, std::forward<F>(f));
+        case 3: return apply_const_at<3>(v, std::forward<F>(f));
+        case 4: return apply_const_at<4>(v, std::forward<F>(f));
+        case 5: return apply_const_at<5>(v, std::forward<F>(f));
+        case 6: return apply_const_at<6>(v, std::forward<F>(f));
+        case 7: return apply_const_at<7>(v, std::forward<F>(f));
+        default: return apply_const_from<8>(v, std::forward<F>(f), which, std::integral_constant<bool, (9 < sizeof...(Types))>());
+        }
     }
 
     VARIANT_INLINE static R apply(V& v, F&& f)
     {
-        return f(unwrapper<T>::apply(v.template get_unchecked<T>()));
+        const int which = v.which();
+        switch (which)
+        {
+        case 0: return apply_at<0>(v, std::forward<F>(f));
+        case 1: return apply_at<1>(v, std::forward<F>(f));
+        case 2: return apply_at<2>(v, std::forward<F>(f));
+        case 3: return apply_at<3>(v, std::forward<F>(f));
+        case 4: return apply_at<4>(v, std::forward<F>(f));
+        case 5: return apply_at<5>(v, std::forward<F>(f));
+        case 6: return apply_at<6>(v, std::forward<F>(f));
+        case 7: return apply_at<7>(v, std::forward<F>(f));
+        default: return apply_from<8>(v, std::forward<F>(f), which, std::integral_constant<bool, (9 < sizeof...(Types))>());
+        }
     }
 };
 
@@ -0,0 +1,1589 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/tdata.hpp"
+#include "../include/tdata_view.hpp"
+#include "../include/tdata_frozen.hpp"
+#include "../include/tdata_stream.hpp"
+#include "../include/tdata_mmap.hpp"
+#include "../include/tdata_parallel.hpp"
+#include "../include/tdata_arena.hpp"
+#include "../include/tdata_intern.hpp"
+#include "../include/tdata_sort.hpp"
+#include "../include/tdata_record.hpp"
+#include "../include/tdata_struct.hpp"
+
+
+// Every operator new is counted so a bench can report the allocations of a decode loop.
+static std::atomic<std::size_t> g_news(0);
+
+void* operator new(std::size_t n)
+{
+    g_news.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(0 != n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+// The row of BenchRecord as a plain struct, for BenchStruct.
+struct Order
+{
+    tdata::int_t id;
+    double px;
+    tdata::str_t sym;
+    tdata::int_t seq;
+    tdata::vreal_t book;
+    double qty;
+    tdata::str_t side;
+    tdata::vint_t tags;
+};
+
+TDATA_STRUCT(Order, id, px, sym, seq, book, qty, side, tags)
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    // Results that must not be optimized away.
+    volatile std::size_t g_sink = 0;
+
+    // Best wall time of `rounds` runs of f, in seconds.
+    template <typename F>
+    double Measure(int rounds, F&& f)
+    {
+        double best = 0;
+        for (int i = 0; i < rounds; ++i)
+        {
+            const auto beg = clock_type::now();
+            f();
+            const double t = std::chrono::duration<double>(clock_type::now() - beg).count();
+            if (0 == i || t < best)
+            {
+                best = t;
+            }
+        }
+        return best;
+    }
+
+    void Report(const char* name, double seconds, std::size_t bytes, std::size_t items)
+    {
+        std::cout << "  " << name << ": " << seconds * 1e3 << " ms, " << bytes / seconds / (1 << 20) << " MB/s";
+        if (0 != items)
+        {
+            std::cout << ", " << items / seconds / 1e6 << " M items/s";
+        }
+        std::cout << std::endl;
+    }
+
+    tdata::vreal_t RandomReals(std::size_t n)
+    {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<tdata::real_t> price(0.0, 1000.0);
+        std::uniform_real_distribution<tdata::real_t> small(0.0, 1e-5);
+        tdata::vreal_t v(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            v[i] = 0 == i % 4 ? small(rng) : price(rng);
+        }
+        return v;
+    }
+
+    // kVReal encoding through the old std::to_string path against tdata_traits<vreal_t>::ToStr.
+    void BenchRealEncode()
+    {
+        std::cout << "vreal_t encode" << std::endl;
+        const auto v = RandomReals(1 << 20);
+        tdata::str_t old_s, new_s;
+        const auto t_old = Measure(5, [&]() {
+            old_s.clear();
+            old_s += tdata::kBegSepStr + tdata::str_t(1, static_cast<char>(tdata::Type::kVReal)) + std::to_string(v.size());
+            for (const auto n : v)
+            {
+                old_s += tdata::kFieldSepStr + std::to_string(n);
+            }
+            old_s += tdata::kEndSepStr;
+        });
+        const auto t_new = Measure(5, [&]() {
+            new_s.clear();
+            tdata::tdata_traits<tdata::vreal_t>::ToStr(v, new_s);
+        });
+        Report("std::to_string", t_old, old_s.size(), v.size());
+        Report("Grisu2        ", t_new, new_s.size(), v.size());
+        std::cout << "  speedup: " << t_old / t_new << "x" << std::endl;
+
+        tdata::vreal_t old_v, new_v;
+        tdata::tdata_traits<tdata::vreal_t>::FromStr(old_v, old_s);
+        tdata::tdata_traits<tdata::vreal_t>::FromStr(new_v, new_s);
+        std::size_t old_lost = 0, new_lost = 0;
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            old_lost += std::memcmp(&old_v[i], &v[i], sizeof(tdata::real_t)) != 0;
+            new_lost += std::memcmp(&new_v[i], &v[i], sizeof(tdata::real_t)) != 0;
+        }
+        std::cout << "  not round-tripped: std::to_string " << old_lost << ", Grisu2 " << new_lost
+                  << " of " << v.size() << std::endl;
+    }
+
+    // kVReal decoding through the old std::strtod path against tdata_traits<vreal_t>::FromStr.
+    void BenchRealDecode()
+    {
+        std::cout << "vreal_t decode" << std::endl;
+        const auto v = RandomReals(1 << 20);
+        tdata::str_t s;
+        tdata::tdata_traits<tdata::vreal_t>::ToStr(v, s);
+
+        tdata::vreal_t old_v, new_v;
+        const auto t_old = Measure(5, [&]() {
+            old_v.clear();
+            char* begptr = nullptr;
+            auto size = std::strtoll(&s[2], &begptr, 10);
+            old_v.reserve(static_cast<std::size_t>(size));
+            while (0 != size--)
+            {
+                old_v.push_back(std::strtod(++begptr, &begptr));
+            }
+        });
+        const auto t_new = Measure(5, [&]() {
+            new_v.clear();
+            tdata::tdata_traits<tdata::vreal_t>::FromStr(new_v, s);
+        });
+        Report("std::strtod ", t_old, s.size(), v.size());
+        Report("FloatParser ", t_new, s.size(), v.size());
+        std::cout << "  speedup: " << t_old / t_new << "x, equal: " << std::boolalpha
+                  << (old_v == v && new_v == v) << std::endl;
+    }
+
+    tdata::vint_t RandomInts(std::size_t n)
+    {
+        std::mt19937_64 rng(42);
+        tdata::vint_t v(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            // Mix of ids, prices in ticks and nanosecond timestamps.
+            switch (i % 3)
+            {
+            case 0: v[i] = static_cast<tdata::int_t>(rng() % 100000); break;
+            case 1: v[i] = -static_cast<tdata::int_t>(rng() % 100000000); break;
+            default: v[i] = 1500000000000000000LL + static_cast<tdata::int_t>(rng() % 100000000000000000LL); break;
+            }
+        }
+        return v;
+    }
+
+    // kVInt decoding through the old std::strtoll path against tdata_traits<vint_t>::FromStr.
+    void BenchIntDecode()
+    {
+        std::cout << "vint_t decode" << std::endl;
+        const auto v = RandomInts(1 << 20);
+        tdata::str_t s;
+        tdata::tdata_traits<tdata::vint_t>::ToStr(v, s);
+
+        tdata::vint_t old_v, new_v;
+        const auto t_old = Measure(5, [&]() {
+            old_v.clear();
+            char* begptr = nullptr;
+            auto size = std::strtoll(&s[2], &begptr, 10);
+            old_v.reserve(static_cast<std::size_t>(size));
+            while (0 != size--)
+            {
+                old_v.push_back(std::strtoll(++begptr, &begptr, 10));
+            }
+        });
+        const auto t_new = Measure(5, [&]() {
+            new_v.clear();
+            tdata::tdata_traits<tdata::vint_t>::FromStr(new_v, s);
+        });
+        Report("std::strtoll", t_old, s.size(), v.size());
+        Report("IntParser   ", t_new, s.size(), v.size());
+        std::cout << "  speedup: " << t_old / t_new << "x, equal: " << std::boolalpha
+                  << (old_v == v && new_v == v) << std::endl;
+    }
+
+    tdata::str_t RandomText(std::size_t n, std::mt19937_64& rng)
+    {
+        // Mostly plain text with the odd ':' or '$' that needs escaping.
+        static const char kChars[] = "abcdefghijklmnopqrstuvwxyz0123456789 _-.";
+        tdata::str_t s(n, ' ');
+        for (auto& c : s)
+        {
+            const auto r = rng() % 1000;
+            c = r == 0 ? ':' : r == 1 ? '$' : kChars[r % (sizeof(kChars) - 1)];
+        }
+        return s;
+    }
+
+    // Boundary finding on long kStr and kVStr values: the old byte loop against StrCoder::Find.
+    void BenchScan()
+    {
+        std::cout << "kStr / kVStr boundary scan" << std::endl;
+        std::mt19937_64 rng(42);
+        tdata::str_t s;
+        tdata::tdata_traits<tdata::str_t>::ToStr(RandomText(64 << 20, rng), s);
+
+        tdata::str_t::size_type old_end = 0, new_end = 0;
+        const auto t_old = Measure(5, [&]() {
+            auto end = tdata::str_t::size_type(2);
+            while (++end < s.size() && (s[end] != tdata::kEndSepChar || s[end - 1] == tdata::kTransChar))
+            {
+            }
+            old_end = end;
+        });
+        const auto t_new = Measure(5, [&]() {
+            tdata::str_t::size_type beg = 0;
+            tdata::detail::StrCoder::CheckTypeAndFindEnd(s, tdata::Type::kStr, beg, new_end);
+        });
+        Report("kStr byte loop", t_old, s.size(), 0);
+        Report("kStr Scanner  ", t_new, s.size(), 0);
+        std::cout << "  speedup: " << t_old / t_new << "x, same end: " << std::boolalpha << (old_end == new_end) << std::endl;
+
+        tdata::vstr_t vs;
+        for (int i = 0; i < 1024; ++i)
+        {
+            vs.push_back(RandomText(64 << 10, rng));
+        }
+        s.clear();
+        tdata::tdata_traits<tdata::vstr_t>::ToStr(vs, s);
+        const auto b = s.data() + 2, e = s.data() + s.size() - 1;
+        std::size_t old_fields = 0, new_fields = 0;
+        const auto t_old_split = Measure(5, [&]() {
+            old_fields = 0;
+            for (auto p = b; p < e; ++p)
+            {
+                old_fields += *p == tdata::kFieldSepChar && *(p - 1) != tdata::kTransChar;
+            }
+        });
+        const auto t_new_split = Measure(5, [&]() {
+            new_fields = 0;
+            for (auto p = tdata::detail::StrCoder::Find(b, e, tdata::kFieldSepChar); p < e; p = tdata::detail::StrCoder::Find(p + 1, e, tdata::kFieldSepChar))
+            {
+                ++new_fields;
+            }
+        });
+        Report("kVStr byte loop", t_old_split, s.size(), vs.size());
+        Report("kVStr Scanner  ", t_new_split, s.size(), vs.size());
+        std::cout << "  speedup: " << t_old_split / t_new_split << "x, fields: " << old_fields << " / " << new_fields << std::endl;
+    }
+
+    // StrCoder::Encode / Decode against the old one-push_back-per-byte loops, on escape-free
+    // short strings (the common case) and on long text with occasional escapes.
+    void BenchEscape()
+    {
+        std::cout << "kStr escape / unescape" << std::endl;
+        std::mt19937_64 rng(42);
+        tdata::vstr_t plain;
+        for (int i = 0; i < 1 << 16; ++i)
+        {
+            plain.push_back(tdata::str_t(8 + rng() % 56, 'a' + static_cast<char>(rng() % 26)));
+        }
+        const auto text = RandomText(64 << 20, rng);
+
+        const auto old_encode = [](const tdata::str_t& s) {
+            tdata::str_t r;
+            r.reserve(s.size());
+            for (const auto c : s)
+            {
+                if (c == tdata::kFieldSepChar || c == tdata::kEndSepChar)
+                {
+                    r.push_back(tdata::kTransChar);
+                }
+                r.push_back(c);
+            }
+            return r;
+        };
+        const auto old_decode = [](const char* b, const char* e) {
+            tdata::str_t r;
+            r.reserve(e - b);
+            for (; b < e; ++b)
+            {
+                if (*b == tdata::kTransChar && (*(b + 1) == tdata::kFieldSepChar || *(b + 1) == tdata::kEndSepChar))
+                {
+                    continue;
+                }
+                r.push_back(*b);
+            }
+            return r;
+        };
+
+        std::size_t plain_bytes = 0, sink = 0;
+        for (const auto& p : plain)
+        {
+            plain_bytes += p.size();
+        }
+        Report("short encode old", Measure(5, [&]() { for (const auto& p : plain) sink += old_encode(p).size(); }), plain_bytes, plain.size());
+        Report("short encode new", Measure(5, [&]() { for (const auto& p : plain) sink += tdata::detail::StrCoder::Encode(p).size(); }), plain_bytes, plain.size());
+        Report("short decode old", Measure(5, [&]() { for (const auto& p : plain) sink += old_decode(p.data(), p.data() + p.size()).size(); }), plain_bytes, plain.size());
+        Report("short decode new", Measure(5, [&]() { for (const auto& p : plain) sink += tdata::detail::StrCoder::Decode(p.data(), p.data() + p.size()).size(); }), plain_bytes, plain.size());
+
+        tdata::str_t enc;
+        const auto t_old_enc = Measure(5, [&]() { enc = old_encode(text); });
+        const auto t_new_enc = Measure(5, [&]() { enc = tdata::detail::StrCoder::Encode(text); });
+        tdata::str_t dec;
+        const auto t_old_dec = Measure(5, [&]() { dec = old_decode(enc.data(), enc.data() + enc.size()); });
+        const auto t_new_dec = Measure(5, [&]() { dec = tdata::detail::StrCoder::Decode(enc.data(), enc.data() + enc.size()); });
+        Report("long encode old ", t_old_enc, text.size(), 0);
+        Report("long encode new ", t_new_enc, text.size(), 0);
+        Report("long decode old ", t_old_dec, enc.size(), 0);
+        Report("long decode new ", t_new_dec, enc.size(), 0);
+        g_sink = sink;
+        std::cout << "  round trip: " << std::boolalpha << (dec == text) << std::endl;
+    }
+
+    // A mixed record stream filtered by type and first char: TData::FromStr against TDataView.
+    void BenchView()
+    {
+        std::cout << "record filter" << std::endl;
+        std::mt19937_64 rng(42);
+        tdata::str_t s;
+        std::size_t records = 0;
+        for (int i = 0; i < 1 << 16; ++i, ++records)
+        {
+            switch (i % 4)
+            {
+            case 0: tdata::TData(static_cast<tdata::int_t>(rng())).ToStr(s); break;
+            case 1: tdata::TData(RandomText(16 + rng() % 48, rng)).ToStr(s); break;
+            case 2: tdata::TData(RandomReals(8)).ToStr(s); break;
+            default: tdata::TData(tdata::vstr_t{ RandomText(12, rng), RandomText(20, rng), RandomText(8, rng) }).ToStr(s); break;
+            }
+        }
+
+        std::size_t old_hits = 0, new_hits = 0;
+        const auto t_old = Measure(5, [&]() {
+            old_hits = 0;
+            tdata::str_t::size_type pos = 0;
+            for (tdata::TData d; pos < s.size() && tdata::TData::FromStr(d, s, &pos); d = tdata::TData())
+            {
+                old_hits += tdata::Type::kStr == d.GetType() && 'a' == d.GetValue<tdata::str_t>()[0];
+            }
+        });
+        const auto t_new = Measure(5, [&]() {
+            new_hits = 0;
+            const char* p = s.data();
+            tdata::TDataView v;
+            tdata::StrView sv;
+            while (nullptr != (p = tdata::TDataView::FromChars(v, p, s.data() + s.size())))
+            {
+                new_hits += v.GetStr(sv) ? 'a' == sv[0] : tdata::Type::kStr == v.GetType() && 'a' == v.GetValue<tdata::str_t>()[0];
+            }
+        });
+        Report("TData::FromStr ", t_old, s.size(), records);
+        Report("TDataView      ", t_new, s.size(), records);
+        std::cout << "  speedup: " << t_old / t_new << "x, hits: " << old_hits << " / " << new_hits << std::endl;
+    }
+
+    // A mixed batch of values encoded and decoded as text (ToStr/FromStr) and binary
+    // (ToBinary/FromBinary).
+    void BenchBinary()
+    {
+        std::cout << "text / binary codec" << std::endl;
+        std::mt19937_64 rng(42);
+        std::vector<tdata::TData> values;
+        const auto ints = RandomInts(1 << 16);
+        const auto reals = RandomReals(1 << 16);
+        for (std::size_t i = 0; i < ints.size(); ++i)
+        {
+            switch (i % 6)
+            {
+            case 0: values.emplace_back(ints[i]); break;
+            case 1: values.emplace_back(reals[i]); break;
+            case 2: values.emplace_back(RandomText(8 + rng() % 56, rng)); break;
+            case 3: values.emplace_back(tdata::vint_t(ints.begin() + i - 3, ints.begin() + i + 5)); break;
+            case 4: values.emplace_back(tdata::vreal_t(reals.begin() + i - 4, reals.begin() + i + 4)); break;
+            default: values.emplace_back(tdata::vstr_t{ RandomText(12, rng), RandomText(20, rng), RandomText(8, rng) }); break;
+            }
+        }
+
+        tdata::str_t text, bin;
+        const auto t_text_enc = Measure(5, [&]() {
+            text.clear();
+            for (const auto& v : values)
+            {
+                v.ToStr(text);
+            }
+        });
+        const auto t_bin_enc = Measure(5, [&]() {
+            bin.clear();
+            for (const auto& v : values)
+            {
+                v.ToBinary(bin);
+            }
+        });
+        std::vector<tdata::TData> text_v, bin_v;
+        const auto t_text_dec = Measure(5, [&]() {
+            text_v.assign(values.size(), tdata::TData());
+            tdata::str_t::size_type pos = 0;
+            for (auto& v : text_v)
+            {
+                tdata::TData::FromStr(v, text, &pos);
+            }
+        });
+        const auto t_bin_dec = Measure(5, [&]() {
+            bin_v.assign(values.size(), tdata::TData());
+            tdata::str_t::size_type pos = 0;
+            for (auto& v : bin_v)
+            {
+                tdata::TData::FromBinary(v, bin, &pos);
+            }
+        });
+        Report("text encode  ", t_text_enc, text.size(), values.size());
+        Report("binary encode", t_bin_enc, bin.size(), values.size());
+        Report("text decode  ", t_text_dec, text.size(), values.size());
+        Report("binary decode", t_bin_dec, bin.size(), values.size());
+        std::cout << "  size: " << text.size() << " / " << bin.size() << " bytes, encode " << t_text_enc / t_bin_enc
+                  << "x, decode " << t_text_dec / t_bin_dec << "x, equal: " << std::boolalpha
+                  << (text_v == values && bin_v == values) << std::endl;
+    }
+
+    // Summing a dump of kVReal records: decoded from text and binary into vectors against read
+    // in place from the frozen layout.
+    void BenchFrozen()
+    {
+        std::cout << "kVReal dump scan" << std::endl;
+        const auto reals = RandomReals(1 << 20);
+        tdata::str_t text, bin;
+        tdata::ByteBuffer frozen;
+        std::size_t records = 0;
+        for (std::size_t i = 0; i < reals.size(); i += 256, ++records)
+        {
+            const tdata::vreal_t v(reals.begin() + i, reals.begin() + i + 256);
+            tdata::tdata_traits<tdata::vreal_t>::ToStr(v, text);
+            tdata::tdata_traits<tdata::vreal_t>::ToBinary(v, bin);
+            tdata::FrozenCoder::Append(v, frozen);
+        }
+
+        tdata::real_t text_sum = 0, bin_sum = 0, frozen_sum = 0;
+        const auto t_text = Measure(5, [&]() {
+            text_sum = 0;
+            tdata::vreal_t v;
+            for (const char* p = text.data(); nullptr != (v.clear(), p = tdata::tdata_traits<tdata::vreal_t>::FromChars(v, p, text.data() + text.size()));)
+            {
+                for (const auto n : v) text_sum += n;
+            }
+        });
+        const auto t_bin = Measure(5, [&]() {
+            bin_sum = 0;
+            tdata::vreal_t v;
+            for (const char* p = bin.data(); nullptr != (v.clear(), p = tdata::tdata_traits<tdata::vreal_t>::FromBinary(v, p, bin.data() + bin.size()));)
+            {
+                for (const auto n : v) bin_sum += n;
+            }
+        });
+        const auto t_frozen = Measure(5, [&]() {
+            frozen_sum = 0;
+            tdata::FrozenView v;
+            for (const char* p = frozen.data(); nullptr != (p = tdata::FrozenView::FromChars(v, p, frozen.data() + frozen.size()));)
+            {
+                for (const auto n : v.GetVReal()) frozen_sum += n;
+            }
+        });
+        Report("text   ", t_text, text.size(), records);
+        Report("binary ", t_bin, bin.size(), records);
+        Report("frozen ", t_frozen, frozen.size(), records);
+        std::cout << "  frozen vs binary: " << t_bin / t_frozen << "x, same sum: " << std::boolalpha
+                  << (text_sum == frozen_sum && bin_sum == frozen_sum) << std::endl;
+    }
+
+    // A record stream read in 4 KB chunks: appended to a growing string and re-scanned from the
+    // last record boundary with TData::FromStr, against StreamDecoder::Feed.
+    void BenchStream()
+    {
+        std::cout << "chunked stream decode" << std::endl;
+        std::mt19937_64 rng(42);
+        tdata::str_t s;
+        std::size_t records = 0;
+        for (int i = 0; i < 1 << 12; ++i, ++records)
+        {
+            // Mostly short records with the odd large one that spans many chunks.
+            tdata::TData(RandomText(0 == i % 64 ? 256 << 10 : rng() % 2048, rng)).ToStr(s);
+        }
+        const std::size_t chunk = 4096;
+
+        std::size_t old_n = 0, new_n = 0;
+        const auto t_old = Measure(5, [&]() {
+            old_n = 0;
+            tdata::str_t acc;
+            for (std::size_t p = 0; p < s.size(); p += chunk)
+            {
+                acc.append(s, p, chunk);
+                tdata::str_t::size_type pos = 0;
+                for (tdata::TData d; pos < acc.size() && tdata::TData::FromStr(d, acc, &pos); d = tdata::TData())
+                {
+                    ++old_n;
+                }
+                acc.erase(0, pos);
+            }
+        });
+        const auto t_new = Measure(5, [&]() {
+            new_n = 0;
+            tdata::StreamDecoder decoder;
+            for (std::size_t p = 0; p < s.size(); p += chunk)
+            {
+                decoder.Feed(s.data() + p, std::min(chunk, s.size() - p), [&](tdata::TData&&) { ++new_n; });
+            }
+        });
+        Report("string + FromStr", t_old, s.size(), records);
+        Report("StreamDecoder   ", t_new, s.size(), records);
+        std::cout << "  speedup: " << t_old / t_new << "x, records: " << old_n << " / " << new_n << std::endl;
+    }
+
+    // Dumping a batch of values to a file: a ToStr string per record handed to fwrite, against
+    // FileWriter and FdWriter.
+    void BenchWriter()
+    {
+        std::cout << "stream writer" << std::endl;
+        std::mt19937_64 rng(42);
+        const auto ints = RandomInts(1 << 18);
+        std::vector<tdata::TData> values;
+        for (std::size_t i = 0; i < ints.size(); ++i)
+        {
+            if (0 == i % 2)
+            {
+                values.emplace_back(ints[i]);
+            }
+            else
+            {
+                values.emplace_back(RandomText(8 + rng() % 24, rng));
+            }
+        }
+        std::size_t bytes = 0;
+        for (const auto& v : values)
+        {
+            bytes += v.ToStr().size();
+        }
+
+        auto file = std::tmpfile();
+        const auto t_old = Measure(5, [&]() {
+            std::rewind(file);
+            for (const auto& v : values)
+            {
+                const auto s = v.ToStr();
+                std::fwrite(s.data(), 1, s.size(), file);
+            }
+            std::fflush(file);
+        });
+        const auto t_file = Measure(5, [&]() {
+            std::rewind(file);
+            tdata::FileWriter writer(file);
+            for (const auto& v : values)
+            {
+                writer.Write(v);
+            }
+            writer.Flush();
+            std::fflush(file);
+        });
+        Report("ToStr + fwrite", t_old, bytes, values.size());
+        Report("FileWriter    ", t_file, bytes, values.size());
+#ifdef TDATA_HAS_POSIX_IO
+        const auto fd = fileno(file);
+        const auto t_fd = Measure(5, [&]() {
+            std::rewind(file);
+            lseek(fd, 0, SEEK_SET);
+            tdata::FdWriter writer(fd);
+            for (const auto& v : values)
+            {
+                writer.Write(v);
+            }
+        });
+        Report("FdWriter      ", t_fd, bytes, values.size());
+#endif
+        std::fclose(file);
+        std::cout << "  speedup: " << t_old / t_file << "x" << std::endl;
+    }
+
+#ifdef TDATA_HAS_POSIX_IO
+    // A record file read whole into a string and decoded with TData::FromStr, against
+    // RecordFile: a sequential walk, the index build and the reopen with a saved index.
+    void BenchRecordFile()
+    {
+        std::cout << "record file" << std::endl;
+        std::mt19937_64 rng(42);
+        char path[] = "/tmp/tdata_bench_XXXXXX";
+        const int fd = mkstemp(path);
+        const tdata::str_t index_path = tdata::str_t(path) + ".idx";
+        std::size_t records = 0;
+        {
+            tdata::FdWriter writer(fd);
+            const auto ints = RandomInts(1 << 20);
+            for (std::size_t i = 0; i < ints.size(); ++i, ++records)
+            {
+                if (0 == i % 2)
+                {
+                    writer.Write(ints[i]);
+                }
+                else
+                {
+                    writer.Write(RandomText(8 + rng() % 120, rng));
+                }
+            }
+        }
+        close(fd);
+
+        std::size_t old_n = 0, new_n = 0, bytes = 0;
+        const auto t_old = Measure(3, [&]() {
+            old_n = 0;
+            auto file = std::fopen(path, "rb");
+            std::fseek(file, 0, SEEK_END);
+            tdata::str_t s(static_cast<std::size_t>(std::ftell(file)), '\0');
+            std::rewind(file);
+            bytes = std::fread(&s[0], 1, s.size(), file);
+            std::fclose(file);
+            tdata::str_t::size_type pos = 0;
+            for (tdata::TData d; pos < s.size() && tdata::TData::FromStr(d, s, &pos); d = tdata::TData())
+            {
+                ++old_n;
+            }
+        });
+        const auto t_walk = Measure(3, [&]() {
+            new_n = 0;
+            tdata::RecordFile file;
+            file.Open(path);
+            file.ForEach([&](const tdata::TDataView& v) { new_n += tdata::Type::kStr != v.GetType() || 0 != v.Size(); });
+        });
+        std::size_t count = 0;
+        const auto t_build = Measure(3, [&]() {
+            tdata::RecordFile file;
+            std::remove(index_path.c_str());
+            file.Open(path, index_path);
+            count = file.Count();
+        });
+        const auto t_reopen = Measure(3, [&]() {
+            tdata::RecordFile file;
+            file.Open(path, index_path);
+            tdata::TData d;
+            g_sink = file.Get(file.Count() / 2, d);
+        });
+        std::remove(path);
+        std::remove(index_path.c_str());
+        Report("read + FromStr   ", t_old, bytes, records);
+        Report("RecordFile views ", t_walk, bytes, records);
+        Report("index build+save ", t_build, bytes, records);
+        std::cout << "  reopen with index + Get(n / 2): " << t_reopen * 1e3 << " ms, records: " << old_n << " / " << new_n << " / " << count << std::endl;
+    }
+#endif
+
+    // Mixed records with '$' and '\' inside strings, decoded by a FromChars loop and by
+    // Parallel::Decode on 1, 2, 4, ... threads up to the core count.
+    tdata::str_t RandomRecords(std::size_t n, std::size_t& records)
+    {
+        std::mt19937_64 rng(42);
+        const auto ints = RandomInts(n);
+        const auto reals = RandomReals(n);
+        tdata::str_t s;
+        for (records = 0; records < n; ++records)
+        {
+            switch (records % 4)
+            {
+            case 0: tdata::tdata_traits<tdata::int_t>::ToStr(ints[records], s); break;
+            case 1: tdata::tdata_traits<tdata::real_t>::ToStr(reals[records], s); break;
+            case 2: tdata::tdata_traits<tdata::str_t>::ToStr(RandomText(8 + rng() % 56, rng) + "\\$", s); break;
+            default: tdata::tdata_traits<tdata::vint_t>::ToStr(tdata::vint_t(ints.begin() + records - 3, ints.begin() + records + 1), s); break;
+            }
+        }
+        return s;
+    }
+
+    void BenchParallelDecode()
+    {
+        std::cout << "parallel decode" << std::endl;
+        std::size_t records = 0;
+        const auto s = RandomRecords(1 << 20, records);
+        std::vector<tdata::TData> seq, par;
+        const auto t_seq = Measure(3, [&]() {
+            seq.clear();
+            for (const char* p = s.data(); p != s.data() + s.size(); )
+            {
+                seq.emplace_back();
+                p = tdata::TData::FromChars(seq.back(), p, s.data() + s.size());
+            }
+        });
+        Report("FromChars loop", t_seq, s.size(), records);
+        const auto cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; ; threads *= 2)
+        {
+            threads = std::min(threads, cores);
+            const auto t = Measure(3, [&]() { tdata::Parallel::Decode(s, par, threads); });
+            std::cout << "  " << threads << " thread(s): " << t * 1e3 << " ms, " << t_seq / t << "x, equal: " << std::boolalpha << (par == seq) << std::endl;
+            if (threads == cores)
+            {
+                break;
+            }
+        }
+    }
+
+    // The decoded records of RandomRecords encoded back by a ToStr loop and by Parallel::Encode.
+    void BenchParallelEncode()
+    {
+        std::cout << "parallel encode" << std::endl;
+        std::size_t records = 0;
+        const auto s = RandomRecords(1 << 20, records);
+        std::vector<tdata::TData> values;
+        tdata::Parallel::Decode(s, values);
+        tdata::ByteBuffer seq, par;
+        const auto t_seq = Measure(3, [&]() {
+            seq.clear();
+            for (const auto& v : values)
+            {
+                v.ToStr(seq);
+            }
+        });
+        Report("ToStr loop", t_seq, seq.size(), records);
+        const auto cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; ; threads *= 2)
+        {
+            threads = std::min(threads, cores);
+            const auto t = Measure(3, [&]() {
+                par.clear();
+                tdata::Parallel::Encode(values, par, threads);
+            });
+            std::cout << "  " << threads << " thread(s): " << t * 1e3 << " ms, " << t_seq / t << "x, identical: " << std::boolalpha
+                      << (par.size() == seq.size() && 0 == std::memcmp(par.data(), seq.data(), seq.size())) << std::endl;
+            if (threads == cores)
+            {
+                break;
+            }
+        }
+    }
+
+    // Many small batches, each just big enough to be split: a FromChars loop, Parallel::Decode
+    // on the shared default pool, and on a pool started and stopped per batch, which is what
+    // every call used to pay.
+    void BenchParallelSmall()
+    {
+        std::cout << "parallel small batches" << std::endl;
+        std::size_t records = 0;
+        const auto s = RandomRecords(1 << 20, records);
+        const auto batch = tdata::Parallel::NextRecord(s.data(), s.data() + s.size(), s.data() + 4 * tdata::Parallel::kMinChunk);
+        const auto size = static_cast<std::size_t>(batch - s.data());
+        const tdata::str_t small(s.data(), size);
+        std::vector<tdata::TData> seq, par;
+        const auto t_seq = Measure(3, [&]() {
+            for (int i = 0; i < 100; ++i)
+            {
+                seq.clear();
+                for (const char* p = small.data(); p != small.data() + small.size(); )
+                {
+                    seq.emplace_back();
+                    p = tdata::TData::FromChars(seq.back(), p, small.data() + small.size());
+                }
+            }
+        });
+        const auto n = seq.size();
+        Report("FromChars loop, 100 batches", t_seq, 100 * size, 100 * n);
+        const auto t_pool = Measure(3, [&]() {
+            for (int i = 0; i < 100; ++i)
+            {
+                tdata::Parallel::Decode(small, par);
+            }
+        });
+        Report("default pool, 100 batches", t_pool, 100 * size, 100 * n);
+        const auto t_fresh = Measure(3, [&]() {
+            for (int i = 0; i < 100; ++i)
+            {
+                tdata::WorkerPool pool;
+                tdata::Parallel::Decode(small, par, 0, &pool);
+            }
+        });
+        Report("pool per batch, 100 batches", t_fresh, 100 * size, 100 * n);
+        std::cout << "  equal: " << std::boolalpha << (par == seq) << std::endl;
+    }
+
+    // Decoding a batch and dropping it, over and over: out-of-line payloads from the heap
+    // against an Arena that is Reset between batches.
+    void BenchArena()
+    {
+        std::cout << "arena batch decode" << std::endl;
+        std::size_t records = 0;
+        const auto s = RandomRecords(1 << 20, records);
+        const auto last = s.data() + s.size();
+        const auto decode = [&](std::vector<tdata::TData>& out, tdata::MemoryResource* resource) {
+            out.resize(records);
+            std::size_t i = 0;
+            for (const char* p = s.data(); p != last; ++i)
+            {
+                p = tdata::TData::FromChars(out[i], p, last, resource);
+            }
+        };
+        // The arena outlives the values that use it.
+        tdata::Arena arena;
+        std::vector<tdata::TData> heap, pooled;
+        const auto t_heap = Measure(5, [&]() {
+            decode(heap, nullptr);
+            std::vector<tdata::TData>().swap(heap);
+        });
+        Report("heap", t_heap, s.size(), records);
+        const auto t_arena = Measure(5, [&]() {
+            decode(pooled, &arena);
+            std::vector<tdata::TData>().swap(pooled);
+            arena.Reset();
+        });
+        Report("arena", t_arena, s.size(), records);
+        decode(heap, nullptr);
+        decode(pooled, &arena);
+        std::cout << "  " << t_heap / t_arena << "x, equal: " << std::boolalpha << (heap == pooled) << ", arena bytes " << arena.Allocated()
+                  << " in " << arena.Reserved() << std::endl;
+    }
+
+    // Heap blocks handed to TData, counted.
+    struct CountingResource : tdata::MemoryResource
+    {
+        std::size_t allocations = 0;
+
+        void* Allocate(std::size_t bytes) override
+        {
+            ++allocations;
+            return std::malloc(bytes);
+        }
+        void Deallocate(void* p, std::size_t) override { std::free(p); }
+    };
+
+    // Decodes a stream of same-shaped records of type T into one reused TData, through a decoded
+    // T and SetValue as before and straight into the TData's storage, counting allocations.
+    template <typename T>
+    void BenchReuseOf(const char* name, const std::vector<tdata::TData>& records)
+    {
+        tdata::str_t s;
+        for (const auto& r : records)
+        {
+            r.ToStr(s);
+        }
+        const auto last = s.data() + s.size();
+        CountingResource resource;
+        std::size_t news = 0;
+        tdata::TData a, b;
+        const auto t_old = Measure(3, [&]() {
+            resource.allocations = 0;
+            news = g_news;
+            for (const char* p = s.data(); p != last; )
+            {
+                typename tdata::tdata_traits<T>::value_type v;
+                p = tdata::tdata_traits<T>::FromChars(v, p, last);
+                a.SetValue(v, &resource);
+            }
+            news = g_news - news;
+        });
+        std::cout << "  " << name << ": decode + SetValue " << t_old * 1e3 << " ms, " << static_cast<double>(news + resource.allocations) / records.size()
+                  << " allocs/record" << std::endl;
+        const auto t_new = Measure(3, [&]() {
+            resource.allocations = 0;
+            news = g_news;
+            for (const char* p = s.data(); p != last; )
+            {
+                p = tdata::TData::FromChars(b, p, last, &resource);
+            }
+            news = g_news - news;
+        });
+        std::cout << "  " << name << ": in place " << t_new * 1e3 << " ms, " << news + resource.allocations << " allocs, " << t_old / t_new
+                  << "x, equal: " << std::boolalpha << (a == b && b == records.back()) << std::endl;
+    }
+
+    void BenchReuse()
+    {
+        std::cout << "decode into a reused TData" << std::endl;
+        const std::size_t n = 1 << 17;
+        const std::size_t width = 16;
+        std::mt19937_64 rng(42);
+        const auto ints = RandomInts(n + width);
+        const auto reals = RandomReals(n + width);
+        std::vector<tdata::TData> strs, vints, vreals, vstrs;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            strs.emplace_back(RandomText(40, rng));
+            vints.emplace_back(tdata::Span<tdata::int_t>(ints.data() + i, width));
+            vreals.emplace_back(tdata::Span<tdata::real_t>(reals.data() + i, width));
+            vstrs.emplace_back(tdata::vstr_t{ RandomText(12, rng), RandomText(12, rng), RandomText(12, rng), RandomText(12, rng) });
+        }
+        BenchReuseOf<tdata::str_t>("str", strs);
+        BenchReuseOf<tdata::vint_t>("vint", vints);
+        BenchReuseOf<tdata::vreal_t>("vreal", vreals);
+        BenchReuseOf<tdata::vstr_t>("vstr", vstrs);
+    }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    std::size_t HeapInUse()
+    {
+        const auto m = mallinfo2();
+        return m.uordblks + m.hblkhd;
+    }
+#else
+    std::size_t HeapInUse() { return 0; }
+#endif
+
+    // Bytes held by an array of mixed values: TData against the tag + variant_t layout it
+    // replaced, counting the array and every heap payload.
+    void BenchMemory()
+    {
+        struct Boxed
+        {
+            tdata::Type type;
+            tdata::variant_t data;
+        };
+        std::cout << "memory per value" << std::endl;
+        const std::size_t n = 1 << 20;
+        const auto ints = RandomInts(n);
+        const auto fill = [&](std::size_t i, tdata::int_t& vi, tdata::real_t& vr, tdata::str_t& vs, tdata::vint_t& vv) {
+            vi = ints[i];
+            vr = static_cast<tdata::real_t>(ints[i]) / 7;
+            vs = "sym" + std::to_string(i % 5000);
+            vv.assign(ints.begin() + i / 4 * 4, ints.begin() + i / 4 * 4 + 4);
+        };
+        tdata::int_t vi;
+        tdata::real_t vr;
+        tdata::str_t vs;
+        tdata::vint_t vv;
+
+        auto before = HeapInUse();
+        std::size_t boxed_bytes = 0;
+        {
+            std::vector<Boxed> boxed(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                fill(i, vi, vr, vs, vv);
+                switch (i % 4)
+                {
+                case 0: boxed[i].data = vi; break;
+                case 1: boxed[i].data = vr; break;
+                case 2: boxed[i].data = vs; break;
+                default: boxed[i].data = vv; break;
+                }
+            }
+            boxed_bytes = HeapInUse() - before;
+        }
+        before = HeapInUse();
+        std::size_t tdata_bytes = 0;
+        {
+            std::vector<tdata::TData> values(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                fill(i, vi, vr, vs, vv);
+                switch (i % 4)
+                {
+                case 0: values[i].SetValue(vi); break;
+                case 1: values[i].SetValue(vr); break;
+                case 2: values[i].SetValue(vs); break;
+                default: values[i].SetValue(vv); break;
+                }
+            }
+            tdata_bytes = HeapInUse() - before;
+        }
+        std::cout << "  sizeof: tag + variant_t " << sizeof(Boxed) << ", TData " << sizeof(tdata::TData) << std::endl;
+        std::cout << "  bytes per value (int, real, short str, 4 x int mix): tag + variant_t " << boxed_bytes / n
+                  << ", TData " << tdata_bytes / n << std::endl;
+    }
+
+    // Short strings and short int vectors, which TData keeps inline: building and summing an
+    // array of them against the tag + variant_t layout, where every one is a heap payload.
+    void BenchSmall()
+    {
+        struct Boxed
+        {
+            tdata::Type type;
+            tdata::variant_t data;
+        };
+        std::cout << "small values" << std::endl;
+        const std::size_t n = 1 << 20;
+        const auto ints = RandomInts(n + 4);
+        std::vector<tdata::str_t> strs(n);
+        std::vector<tdata::vint_t> vecs(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            strs[i] = "sym" + std::to_string(i % 5000);
+            vecs[i].assign(ints.begin() + i, ints.begin() + i + 1 + i % TDATA_INLINE_WORDS);
+        }
+
+        std::vector<Boxed> boxed;
+        std::size_t boxed_bytes = 0;
+        const auto t_boxed = Measure(3, [&]() {
+            boxed.clear();
+            boxed.shrink_to_fit();
+            const auto before = HeapInUse();
+            boxed.resize(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                boxed[i].type = 0 == i % 2 ? tdata::Type::kStr : tdata::Type::kVInt;
+                if (0 == i % 2)
+                {
+                    boxed[i].data = strs[i];
+                }
+                else
+                {
+                    boxed[i].data = vecs[i];
+                }
+            }
+            boxed_bytes = HeapInUse() - before;
+        });
+        std::vector<tdata::TData> values;
+        std::size_t tdata_bytes = 0;
+        const auto t_tdata = Measure(3, [&]() {
+            values.clear();
+            values.shrink_to_fit();
+            const auto before = HeapInUse();
+            values.resize(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (0 == i % 2)
+                {
+                    values[i].SetValue(strs[i]);
+                }
+                else
+                {
+                    values[i].SetValue(vecs[i]);
+                }
+            }
+            tdata_bytes = HeapInUse() - before;
+        });
+        std::cout << "  build: tag + variant_t " << t_boxed * 1e3 << " ms, TData " << t_tdata * 1e3 << " ms, " << t_boxed / t_tdata << "x"
+                  << std::endl;
+
+        std::size_t sum_boxed = 0;
+        const auto i_boxed = Measure(5, [&]() {
+            sum_boxed = 0;
+            for (const auto& b : boxed)
+            {
+                if (tdata::Type::kStr == b.type)
+                {
+                    sum_boxed += b.data.get<tdata::str_t>().size();
+                }
+                else
+                {
+                    for (auto x : b.data.get<tdata::vint_t>())
+                    {
+                        sum_boxed += static_cast<std::size_t>(x);
+                    }
+                }
+            }
+        });
+        std::size_t sum_tdata = 0;
+        const auto i_tdata = Measure(5, [&]() {
+            sum_tdata = 0;
+            for (const auto& v : values)
+            {
+                if (tdata::Type::kStr == v.GetType())
+                {
+                    sum_tdata += v.GetValue<tdata::str_t>().size();
+                }
+                else
+                {
+                    for (auto x : v.GetValue<tdata::vint_t>())
+                    {
+                        sum_tdata += static_cast<std::size_t>(x);
+                    }
+                }
+            }
+        });
+        std::cout << "  iterate: tag + variant_t " << i_boxed * 1e3 << " ms, TData " << i_tdata * 1e3 << " ms, " << i_boxed / i_tdata
+                  << "x, same sum: " << std::boolalpha << (sum_boxed == sum_tdata) << std::endl;
+        std::cout << "  bytes per value: tag + variant_t " << boxed_bytes / n << ", TData " << tdata_bytes / n << " (sizeof "
+                  << sizeof(tdata::TData) << ")" << std::endl;
+    }
+
+    // Symbol-heavy records: kVStr of 8 tickers drawn from 4000 and kStr host names drawn from
+    // 2000, decoded as is and through a StrPool, then compared against a second decode.
+    void BenchIntern()
+    {
+        std::cout << "interned strings" << std::endl;
+        const std::size_t n = 1 << 18;
+        std::mt19937_64 rng(42);
+        std::vector<tdata::str_t> tickers, hosts;
+        for (int i = 0; i < 4000; ++i)
+        {
+            tickers.push_back("T" + std::to_string(10000 + i) + ".XNAS");
+        }
+        for (int i = 0; i < 2000; ++i)
+        {
+            hosts.push_back("host-" + std::to_string(1000 + i) + ".prod.example.com");
+        }
+        tdata::str_t s;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (0 == i % 2)
+            {
+                tdata::vstr_t v;
+                for (int k = 0; k < 8; ++k)
+                {
+                    v.push_back(tickers[rng() % tickers.size()]);
+                }
+                tdata::TData(v).ToStr(s);
+            }
+            else
+            {
+                tdata::TData(hosts[rng() % hosts.size()]).ToStr(s);
+            }
+        }
+        const auto last = s.data() + s.size();
+
+        tdata::StrPool pool;
+        const auto decode = [&](std::vector<tdata::TData>& out, tdata::StrPool* p) {
+            out.assign(n, tdata::TData());
+            std::size_t i = 0;
+            for (const char* q = s.data(); q != last; ++i)
+            {
+                q = nullptr != p ? tdata::TData::FromChars(out[i], q, last, *p) : tdata::TData::FromChars(out[i], q, last);
+            }
+        };
+        std::vector<tdata::TData> plain, plain2, pooled, pooled2;
+        auto before = HeapInUse();
+        decode(plain, nullptr);
+        const auto plain_bytes = HeapInUse() - before;
+        before = HeapInUse();
+        decode(pooled, &pool);
+        const auto pooled_bytes = HeapInUse() - before;
+        const auto t_plain = Measure(5, [&]() { decode(plain2, nullptr); });
+        const auto t_pooled = Measure(5, [&]() { decode(pooled2, &pool); });
+        Report("decode", t_plain, s.size(), n);
+        Report("decode through StrPool", t_pooled, s.size(), n);
+        std::cout << "  heap bytes per record: " << plain_bytes / n << " vs " << pooled_bytes / n << " (pool of " << pool.Size() << " strings)"
+                  << std::endl;
+
+        std::size_t equal_plain = 0;
+        std::size_t equal_pooled = 0;
+        const auto t_eq_plain = Measure(5, [&]() {
+            equal_plain = 0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                equal_plain += plain[i] == plain2[(i + 2) % n];
+            }
+        });
+        const auto t_eq_pooled = Measure(5, [&]() {
+            equal_pooled = 0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                equal_pooled += pooled[i] == pooled2[(i + 2) % n];
+            }
+        });
+        const auto t_self_plain = Measure(5, [&]() { g_sink = plain == plain2; });
+        const auto t_self_pooled = Measure(5, [&]() { g_sink = pooled == pooled2; });
+        std::cout << "  compare mostly unequal: " << t_eq_plain * 1e3 << " ms vs " << t_eq_pooled * 1e3 << " ms, " << t_eq_plain / t_eq_pooled
+                  << "x, same answers: " << std::boolalpha << (equal_plain == equal_pooled) << std::endl;
+        std::cout << "  compare equal: " << t_self_plain * 1e3 << " ms vs " << t_self_pooled * 1e3 << " ms, " << t_self_plain / t_self_pooled << "x"
+                  << std::endl;
+    }
+
+    // std::hash<TData> over long numeric vectors and short strings.
+    void BenchHash()
+    {
+        std::cout << "hash" << std::endl;
+        const std::size_t n = 1 << 14;
+        std::vector<tdata::TData> reals, ints, strs;
+        const auto r = RandomReals(1000);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            auto v = r;
+            v[i % v.size()] = static_cast<tdata::real_t>(i);
+            reals.emplace_back(v);
+            ints.emplace_back(tdata::vint_t(v.begin(), v.end()));
+            strs.emplace_back("T" + std::to_string(10000 + i) + ".XNAS");
+        }
+        const std::hash<tdata::TData> hash;
+        const auto run = [&](const char* name, const std::vector<tdata::TData>& values, std::size_t bytes) {
+            const auto t = Measure(5, [&]() {
+                std::size_t h = 0;
+                for (const auto& v : values)
+                {
+                    h ^= hash(v);
+                }
+                g_sink = h;
+            });
+            Report(name, t, bytes, values.size());
+        };
+        run("vreal of 1000", reals, n * 1000 * sizeof(tdata::real_t));
+        run("vint of 1000", ints, n * 1000 * sizeof(tdata::int_t));
+        run("short str", strs, n * 10);
+    }
+
+    // tdata::Sort against std::sort through operator<.
+    void BenchSort()
+    {
+        std::cout << "sort" << std::endl;
+        const std::size_t n = 1 << 20;
+        std::mt19937_64 rng(42);
+        const auto reals = RandomReals(n);
+        std::vector<tdata::TData> ints, rs, mixed;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            ints.emplace_back(static_cast<tdata::int_t>(rng() % 100000000) - 50000000);
+            rs.emplace_back(reals[i] - 500);
+            if (0 == i % 4)
+            {
+                mixed.emplace_back("T" + std::to_string(rng() % 100000));
+            }
+            else
+            {
+                mixed.emplace_back(ints.back());
+            }
+        }
+        const auto run = [&](const char* name, const std::vector<tdata::TData>& values) {
+            std::vector<tdata::TData> a, b;
+            const auto t_std = Measure(3, [&]() {
+                a = values;
+                std::sort(a.begin(), a.end());
+            });
+            const auto t_radix = Measure(3, [&]() {
+                b = values;
+                tdata::Sort(b);
+            });
+            std::cout << "  " << name << ": std::sort " << t_std * 1e3 << " ms, tdata::Sort " << t_radix * 1e3 << " ms, " << t_std / t_radix
+                      << "x, same order: " << std::boolalpha << std::equal(a.begin(), a.end(), b.begin(), tdata::ExactEqual()) << std::endl;
+        };
+        run("1M kInt", ints);
+        run("1M kReal", rs);
+        run("1M kInt and kStr", mixed);
+    }
+
+    // Equality and FindMismatch of long vectors that differ only near the end, against the
+    // element-at-a-time compares they replace.
+    void BenchMismatch()
+    {
+        std::cout << "mismatch" << std::endl;
+        const std::size_t n = 1 << 12;
+        const std::size_t rounds = 2000;
+        const auto r = RandomReals(n);
+        const tdata::vint_t iv(r.begin(), r.end());
+        auto r2 = r;
+        auto iv2 = iv;
+        r2[n - 3] += 1;
+        iv2[n - 3] += 1;
+        const tdata::TData a(r), b(r2), c(r), x(iv), y(iv2), z(iv);
+        const auto run = [&](const char* name, const std::function<std::size_t()>& f, std::size_t bytes) {
+            const auto t = Measure(5, [&]() {
+                std::size_t sum = 0;
+                for (std::size_t k = 0; k < rounds; ++k)
+                {
+                    sum += f();
+                }
+                g_sink = sum;
+            });
+            Report(name, t, bytes * rounds, 0);
+        };
+        const auto span_a = a.GetValue<tdata::vreal_t>();
+        const auto span_c = c.GetValue<tdata::vreal_t>();
+        const auto span_x = x.GetValue<tdata::vint_t>();
+        const auto span_z = z.GetValue<tdata::vint_t>();
+        const auto eps = std::numeric_limits<tdata::real_t>::epsilon();
+        run("vreal == elementwise", [&]() -> std::size_t {
+            return std::equal(span_a.begin(), span_a.end(), span_c.begin(), [eps](tdata::real_t p, tdata::real_t q) { return fabs(p - q) < eps; });
+        }, 2 * n * sizeof(tdata::real_t));
+        run("vreal ==", [&]() -> std::size_t { return a == c; }, 2 * n * sizeof(tdata::real_t));
+        run("vreal FindMismatch", [&]() { return tdata::FindMismatch(a, b); }, 2 * n * sizeof(tdata::real_t));
+        run("vreal FindMismatch ulps", [&]() { return tdata::FindMismatch(a, b, tdata::Tolerance::Ulps(4)); }, 2 * n * sizeof(tdata::real_t));
+        run("vint == elementwise", [&]() -> std::size_t { return std::equal(span_x.begin(), span_x.end(), span_z.begin()); }, 2 * n * sizeof(tdata::int_t));
+        run("vint ==", [&]() -> std::size_t { return x == z; }, 2 * n * sizeof(tdata::int_t));
+        run("vint FindMismatch", [&]() { return tdata::FindMismatch(x, y); }, 2 * n * sizeof(tdata::int_t));
+    }
+
+    // Sizes of all six types, the visitor of BenchVisit.
+    struct SizeOf
+    {
+        std::size_t operator()(tdata::int_t v) const { return static_cast<std::size_t>(v); }
+        std::size_t operator()(tdata::real_t v) const { return static_cast<std::size_t>(v); }
+        template <typename T>
+        std::size_t operator()(const T& v) const { return v.size(); }
+    };
+
+    // Dispatch on mixed-type arrays: TData::Visit's jump table against testing the types in
+    // turn, and variant_t's visit and copy.
+    void BenchVisit()
+    {
+        std::cout << "visit" << std::endl;
+        const std::size_t n = 1 << 20;
+        std::mt19937_64 rng(42);
+        std::vector<tdata::TData> values;
+        std::vector<tdata::variant_t> variants;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            switch (rng() % 6)
+            {
+            case 0: values.emplace_back(static_cast<tdata::int_t>(i)); variants.emplace_back(static_cast<tdata::int_t>(i)); break;
+            case 1: values.emplace_back(0.5 * i); variants.emplace_back(0.5 * i); break;
+            case 2: values.emplace_back(tdata::str_t("ab")); variants.emplace_back(tdata::str_t("ab")); break;
+            case 3: values.emplace_back(tdata::vint_t{ 1 }); variants.emplace_back(tdata::vint_t{ 1 }); break;
+            case 4: values.emplace_back(tdata::vreal_t{ 1, 2 }); variants.emplace_back(tdata::vreal_t{ 1, 2 }); break;
+            default: values.emplace_back(tdata::vstr_t{ "x" }); variants.emplace_back(tdata::vstr_t{ "x" }); break;
+            }
+        }
+        const SizeOf size_of;
+        std::size_t a = 0, b = 0;
+        const auto t_visit = Measure(5, [&]() {
+            a = 0;
+            for (const auto& v : values)
+            {
+                a += v.Visit(size_of);
+            }
+        });
+        const auto t_chain = Measure(5, [&]() {
+            b = 0;
+            for (const auto& v : values)
+            {
+                const auto type = v.GetType();
+                if (tdata::Type::kInt == type)
+                {
+                    b += size_of(v.GetValue<tdata::int_t>());
+                }
+                else if (tdata::Type::kReal == type)
+                {
+                    b += size_of(v.GetValue<tdata::real_t>());
+                }
+                else if (tdata::Type::kStr == type)
+                {
+                    b += size_of(v.GetValue<tdata::str_t>());
+                }
+                else if (tdata::Type::kVInt == type)
+                {
+                    b += size_of(v.GetValue<tdata::vint_t>());
+                }
+                else if (tdata::Type::kVReal == type)
+                {
+                    b += size_of(v.GetValue<tdata::vreal_t>());
+                }
+                else if (tdata::Type::kVStr == type)
+                {
+                    b += size_of(v.GetValue<tdata::vstr_t>());
+                }
+            }
+        });
+        std::cout << "  TData: Visit " << t_visit * 1e3 << " ms, type chain " << t_chain * 1e3 << " ms, " << t_chain / t_visit
+                  << "x, same sums: " << std::boolalpha << (a == b) << std::endl;
+        std::size_t c = 0;
+        const auto t_variant = Measure(5, [&]() {
+            c = 0;
+            for (const auto& v : variants)
+            {
+                c += tdata::variant_t::visit(v, size_of);
+            }
+        });
+        const auto t_copy = Measure(5, [&]() {
+            const auto copy = variants;
+            g_sink = copy.size();
+        });
+        std::cout << "  variant_t: visit " << t_variant * 1e3 << " ms, copy and destroy " << t_copy * 1e3 << " ms, same sums: " << (a == c)
+                  << std::endl;
+    }
+
+    // Rows of eight fields: TRecord's schema-driven decode and encode against decoding each
+    // field through TData::FromChars and encoding it through TData::ToStr.
+    void BenchRecord()
+    {
+        std::cout << "record" << std::endl;
+        const std::size_t n = 1 << 17;
+        const tdata::Schema schema{ tdata::Type::kInt, tdata::Type::kReal, tdata::Type::kStr, tdata::Type::kInt,
+                                    tdata::Type::kVReal, tdata::Type::kReal, tdata::Type::kStr, tdata::Type::kVInt };
+        const auto reals = RandomReals(n);
+        std::mt19937_64 rng(42);
+        tdata::TRecord row(schema);
+        tdata::str_t s;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            row.Set(0, static_cast<tdata::int_t>(rng() % 1000000));
+            row.Set(1, reals[i]);
+            row.Set(2, "T" + std::to_string(10000 + i % 4000) + ".XNAS");
+            row.Set(3, static_cast<tdata::int_t>(i));
+            row.Set(4, tdata::vreal_t{ reals[i], reals[(i + 1) % n], reals[(i + 2) % n] });
+            row.Set(5, reals[(i + 3) % n]);
+            row.Set(6, tdata::str_t(i % 3 ? "buy" : "sell"));
+            row.Set(7, tdata::vint_t{ static_cast<tdata::int_t>(i % 100), 7 });
+            row.ToStr(s);
+        }
+        const auto last = s.data() + s.size();
+
+        std::vector<tdata::TData> fields(schema.Size());
+        std::size_t rows = 0;
+        const auto t_fields = Measure(5, [&]() {
+            rows = 0;
+            for (const char* p = s.data(); nullptr != p && p != last; ++rows)
+            {
+                for (auto& f : fields)
+                {
+                    p = nullptr != p ? tdata::TData::FromChars(f, p, last) : nullptr;
+                }
+            }
+        });
+        std::size_t records = 0;
+        const auto t_record = Measure(5, [&]() {
+            records = 0;
+            for (const char* p = s.data(); nullptr != p && p != last; ++records)
+            {
+                p = tdata::TRecord::FromChars(row, p, last);
+            }
+        });
+        Report("decode per field", t_fields, s.size(), rows);
+        Report("decode TRecord", t_record, s.size(), records);
+        std::cout << "  " << t_fields / t_record << "x, same rows: " << std::boolalpha << (rows == n && records == n) << std::endl;
+
+        tdata::ByteBuffer out;
+        const auto t_enc_fields = Measure(5, [&]() {
+            out.clear();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                for (const auto& f : fields)
+                {
+                    f.ToStr(out);
+                }
+            }
+        });
+        const auto t_enc_record = Measure(5, [&]() {
+            out.clear();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                row.ToStr(out);
+            }
+        });
+        Report("encode per field", t_enc_fields, out.size(), n);
+        Report("encode TRecord", t_enc_record, out.size(), n);
+    }
+
+    // Rows of a struct read from and written to text: through a TRecord whose fields are copied
+    // to and from the struct, against StructCoder straight on the members.
+    void BenchStruct()
+    {
+        std::cout << "struct" << std::endl;
+        const std::size_t n = 1 << 17;
+        const tdata::Schema schema{ tdata::Type::kInt, tdata::Type::kReal, tdata::Type::kStr, tdata::Type::kInt,
+                                    tdata::Type::kVReal, tdata::Type::kReal, tdata::Type::kStr, tdata::Type::kVInt };
+        const auto reals = RandomReals(n);
+        std::mt19937_64 rng(42);
+        std::vector<Order> orders(n);
+        tdata::str_t s;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            auto& o = orders[i];
+            o.id = static_cast<tdata::int_t>(rng() % 1000000);
+            o.px = reals[i];
+            o.sym = "T" + std::to_string(10000 + i % 4000) + ".XNAS";
+            o.seq = static_cast<tdata::int_t>(i);
+            o.book = { reals[i], reals[(i + 1) % n], reals[(i + 2) % n] };
+            o.qty = reals[(i + 3) % n];
+            o.side = i % 3 ? "buy" : "sell";
+            o.tags = { static_cast<tdata::int_t>(i % 100), 7 };
+            tdata::StructCoder::ToStr(o, s);
+        }
+        const auto last = s.data() + s.size();
+
+        tdata::TRecord row(schema);
+        Order o{};
+        std::size_t boxed = 0;
+        const auto t_record = Measure(5, [&]() {
+            boxed = 0;
+            for (const char* p = s.data(); nullptr != p && p != last; ++boxed)
+            {
+                p = tdata::TRecord::FromChars(row, p, last);
+                o.id = row[0].GetValue<tdata::int_t>();
+                o.px = row[1].GetValue<tdata::real_t>();
+                o.sym = row[2].GetValue<tdata::str_t>();
+                o.seq = row[3].GetValue<tdata::int_t>();
+                o.book = row[4].GetValue<tdata::vreal_t>();
+                o.qty = row[5].GetValue<tdata::real_t>();
+                o.side = row[6].GetValue<tdata::str_t>();
+                o.tags = row[7].GetValue<tdata::vint_t>();
+            }
+        });
+        std::size_t direct = 0;
+        bool same = true;
+        const auto t_struct = Measure(5, [&]() {
+            direct = 0;
+            for (const char* p = s.data(); nullptr != p && p != last; ++direct)
+            {
+                p = tdata::StructCoder::FromChars(o, p, last);
+            }
+            same = o.id == orders[n - 1].id && o.sym == orders[n - 1].sym && o.tags == orders[n - 1].tags;
+        });
+        Report("decode TRecord + copy", t_record, s.size(), boxed);
+        Report("decode StructCoder", t_struct, s.size(), direct);
+        std::cout << "  " << t_record / t_struct << "x, same rows: " << std::boolalpha << (boxed == n && direct == n && same) << std::endl;
+
+        tdata::ByteBuffer out;
+        const auto t_enc_record = Measure(5, [&]() {
+            out.clear();
+            for (const auto& v : orders)
+            {
+                row.Set(0, v.id);
+                row.Set(1, v.px);
+                row.Set(2, v.sym);
+                row.Set(3, v.seq);
+                row.Set(4, v.book);
+                row.Set(5, v.qty);
+                row.Set(6, v.side);
+                row.Set(7, v.tags);
+                row.ToStr(out);
+            }
+        });
+        const auto boxed_size = out.size();
+        const auto t_enc_struct = Measure(5, [&]() {
+            out.clear();
+            for (const auto& v : orders)
+            {
+                tdata::StructCoder::ToStr(v, out);
+            }
+        });
+        Report("encode TRecord + copy", t_enc_record, out.size(), n);
+        Report("encode StructCoder", t_enc_struct, out.size(), n);
+        std::cout << "  " << t_enc_record / t_enc_struct << "x, same bytes: " << (boxed_size == s.size() && out.size() == s.size()
+                  && 0 == std::memcmp(out.data(), s.data(), s.size())) << std::endl;
+    }
+
+    struct Bench
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Bench kBenches[] =
+    {
+        { "real_encode", BenchRealEncode },
+        { "real_decode", BenchRealDecode },
+        { "int_decode", BenchIntDecode },
+        { "scan", BenchScan },
+        { "escape", BenchEscape },
+        { "view", BenchView },
+        { "binary", BenchBinary },
+        { "frozen", BenchFrozen },
+        { "stream", BenchStream },
+        { "writer", BenchWriter },
+        { "parallel_decode", BenchParallelDecode },
+        { "parallel_encode", BenchParallelEncode },
+        { "parallel_small", BenchParallelSmall },
+        { "memory", BenchMemory },
+        { "small", BenchSmall },
+        { "arena", BenchArena },
+        { "reuse", BenchReuse },
+        { "intern", BenchIntern },
+        { "hash", BenchHash },
+        { "sort", BenchSort },
+        { "mismatch", BenchMismatch },
+        { "visit", BenchVisit },
+        { "record", BenchRecord },
+        { "struct", BenchStruct },
+#ifdef TDATA_HAS_POSIX_IO
+        { "record_file", BenchRecordFile },
+#endif
+    };
+}
+
+// Usage: tdata_bench [name...]; runs every benchmark when no name is given.
+int main(int argc, char* argv[])
+{
+    for (const auto& b : kBenches)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+        {
+            selected = 0 == std::strcmp(argv[i], b.name);
+        }
+        if (selected)
+        {
+            b.run();
+        }
+    }
+    return 0;
+}
@@ -1,7 +1,23 @@
 #include <iostream>
+#include <atomic>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include <type_traits>
 #include <iostream>
 #include "../include/tdata.hpp"
+#include "../include/tdata_view.hpp"
+#include "../include/tdata_frozen.hpp"
+#include "../include/tdata_stream.hpp"
+#include "../include/tdata_mmap.hpp"
+#include "../include/tdata_parallel.hpp"
+#include "../include/tdata_arena.hpp"
+#include "../include/tdata_intern.hpp"
+#include "../include/tdata_sort.hpp"
+#include "../include/tdata_record.hpp"
+#include "../include/tdata_struct.hpp"
 
 
 #define K_JOIN(a, b) K_JOIN_HELPER(a, b)
@@ -42,6 +58,20 @@
         const tdata::TData ct_tm_b(std::move(t_t_b));                                           \
     } while (false)
 
+struct Quote
+{
+    tdata::str_t sym;
+    int32_t size;
+    double bid;
+    float ask;
+    bool live;
+    tdata::vint_t ids;
+    tdata::vreal_t levels;
+    tdata::vstr_t venues;
+};
+
+TDATA_STRUCT(Quote, sym, size, bid, ask, live, ids, levels, venues)
+
 int main()
 {
     TEST_TYPE_DEF(int8_t, i8, 1);
@@ -165,6 +195,707 @@ int main()
         std::cout << data.ToStr() << std::endl;
     } while (pos <= ks.size());
 
+    std::cout << "============================================" << std::endl;
+
+    tdata::TData d_esc(tdata::vstr_t{ R"K(a\b)K", R"K(\)K", "", R"K(:$\)K" }), d_esc_r;
+    const auto esc = d_esc.ToStr() + tdata::TData(tdata::str_t()).ToStr();
+    std::cout << esc << std::endl;
+    pos = 0;
+    while (pos < esc.size() && tdata::TData::FromStr(d_esc_r, esc, &pos))
+    {
+        std::copy(d_esc_r.GetValue<tdata::vstr_t>().begin(), d_esc_r.GetValue<tdata::vstr_t>().end(), std::ostream_iterator<tdata::str_t>(std::cout, "|"));
+        std::cout << std::boolalpha << (d_esc_r == d_esc) << std::endl;
+        d_esc_r = tdata::TData();
+    }
+    for (const auto raw : { R"K(a\)K", R"K(\:)K", R"K(\\)K", R"K(\$x)K", R"K(x\y)K" })
+    {
+        const tdata::TData v{ tdata::str_t(raw) };
+        tdata::TData r;
+        std::cout << v.ToStr() << " " << (tdata::TData::FromStr(r, v.ToStr()) && r == v) << " ";
+    }
+    // Text of the original format, which escaped only ':' and '$', reads back unchanged.
+    tdata::TData legacy;
+    tdata::TData::FromStr(legacy, R"K(^sa\b\:c$)K");
+    std::cout << legacy.GetValue<tdata::str_t>() << std::endl;
+
+    std::cout << "============================================" << std::endl;
+
+    tdata::Encoder encoder;
+    for (int round = 0; round < 2; ++round)
+    {
+        encoder.Clear();
+        encoder.Append(d_i64).Append(d_d).Append(d_str).Append(vd_vi2).Append(vd_vr2).Append(vd_vs2);
+        encoder.Append(tdata::int_t(-9223372036854775807LL - 1)).Append(tdata::str_t("a:b"));
+        std::cout << encoder.Buffer() << std::endl;
+    }
+    tdata::ByteBuffer bytes;
+    vd_vs2.ToStr(bytes);
+    tdata::tdata_traits<tdata::vint_t>::ToStr(vi2, bytes);
+    std::cout << std::boolalpha << (bytes.str() == vd_vs2.ToStr() + vd_vi2.ToStr()) << std::endl;
+
+    std::cout << "============================================" << std::endl;
+
+    const tdata::TData bins[] = { d_i64, d_u64, d_d, d_str, vd_vi2, vd_vr2, vd_vs2, d_esc, tdata::TData(tdata::int_t(-9223372036854775807LL - 1)) };
+    tdata::str_t bin;
+    for (const auto& b : bins)
+    {
+        b.ToBinary(bin);
+    }
+    pos = 0;
+    for (const auto& b : bins)
+    {
+        tdata::TData data;
+        const auto ok = tdata::TData::FromBinary(data, bin, &pos);
+        std::cout << std::boolalpha << (ok && data == b) << " " << b.ToBinary().size() << " / " << b.ToStr().size() << std::endl;
+    }
+    std::cout << std::boolalpha << (pos == bin.size()) << std::endl;
+
+    tdata::ByteBuffer frozen;
+    for (const auto& b : bins)
+    {
+        tdata::FrozenCoder::Append(b, frozen);
+    }
+    tdata::FrozenView fv;
+    const char* fp = frozen.data();
+    for (const auto& b : bins)
+    {
+        tdata::TData data;
+        fp = tdata::FrozenView::FromChars(fv, fp, frozen.data() + frozen.size());
+        std::cout << std::boolalpha << (nullptr != fp && fv.ToTData(data) && data == b) << " " << fv.Size();
+        for (const auto n : fv.GetVInt())
+        {
+            std::cout << " " << n;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << std::boolalpha << (fp == frozen.data() + frozen.size()) << " " << frozen.size() << std::endl;
+
+    std::cout << "============================================" << std::endl;
+
+    const auto views = ks + esc;
+    const char* vp = views.data();
+    tdata::TDataView view;
+    while (nullptr != (vp = tdata::TDataView::FromChars(view, vp, views.data() + views.size())))
+    {
+        std::cout << static_cast<int>(view.GetType()) << " " << view.Size() << " " << view.GetPayload() << " ->";
+        tdata::StrView sv;
+        if (view.GetStr(sv))
+        {
+            std::cout << " [" << sv << "]";
+        }
+        view.ForEach<tdata::vint_t>([](tdata::int_t n) { std::cout << " " << n; });
+        view.ForEach<tdata::vreal_t>([](tdata::real_t n) { std::cout << " " << n; });
+        view.ForEach<tdata::vstr_t>([](tdata::StrView s) { std::cout << " [" << s << "]"; });
+        tdata::TData data;
+        std::cout << " " << std::boolalpha << (view.ToTData(data) && data.ToStr() == view.GetText().str()) << std::endl;
+    }
+    for (const auto bad : { "^I-1:1$", "^R99999999999999999:1$", "^S5:a:b$", "^I2:1:2$" })
+    {
+        std::cout << tdata::TDataView::FromStr(view, bad) << " ";
+    }
+    std::cout << std::endl;
+
+    std::cout << "============================================" << std::endl;
+
+    for (tdata::str_t::size_type chunk = 1; chunk <= 7; chunk += 3)
+    {
+        tdata::StreamDecoder decoder;
+        tdata::str_t out;
+        for (tdata::str_t::size_type p = 0; p < views.size(); p += chunk)
+        {
+            decoder.Feed(views.data() + p, std::min(chunk, views.size() - p), [&](tdata::TData&& v) { v.ToStr(out); });
+        }
+        std::cout << chunk << " " << std::boolalpha << (out == views) << " " << decoder.Pending() << std::endl;
+    }
+    {
+        // Records whose '$' is already known decode as FromChars would, bad numbers included; a
+        // stream stops at the default limit unless it is lifted with 0.
+        bool same = true;
+        for (const char* text : { "^i12$", "^i12x$", "^r$", "^r1.5$", "^s\\$$", "^I2:1:2$", "^I2:1:2x$", "^R1:0.5$", "^S2:a:b\\:c$", "^S3:a$", "^x1$" })
+        {
+            const auto n = std::strlen(text);
+            tdata::TData a, b;
+            const auto ea = tdata::TData::FromChars(a, text, text + n);
+            const auto eb = tdata::TData::FromRecord(b, text, text + n - 1);
+            same = same && ea == eb && (nullptr == ea || a == b);
+        }
+        const tdata::str_t big = "^s" + tdata::str_t(tdata::StreamDecoder::kDefaultMaxRecord, 'x');
+        tdata::StreamDecoder limited, unlimited(0);
+        const auto ignore = [](tdata::TData&&) {};
+        std::cout << std::boolalpha << same << " " << limited.Feed(big, ignore) << " " << unlimited.Feed(big, ignore) << " " << unlimited.Pending()
+                  << std::endl;
+    }
+
+    std::ostringstream oss;
+    {
+        tdata::OStreamWriter writer(oss, 16);
+        for (const auto& b : bins)
+        {
+            writer.Write(b);
+        }
+        for (const auto& b : bins)
+        {
+            writer.WriteBinary(b);
+        }
+        writer.Write(tdata::vint_t{ 1, 2 }).WriteBinary(tdata::str_t("ok"));
+    }
+    tdata::str_t expect;
+    for (const auto& b : bins)
+    {
+        b.ToStr(expect);
+    }
+    expect += bin + tdata::TData(tdata::vint_t{ 1, 2 }).ToStr() + tdata::TData(tdata::str_t("ok")).ToBinary();
+    std::cout << std::boolalpha << (oss.str() == expect) << std::endl;
+    {
+        // Bytes a failed sink refused are not counted as written.
+        std::ostringstream broken;
+        broken.setstate(std::ios::badbit);
+        tdata::OStreamWriter writer(broken, 16);
+        writer.Write(tdata::str_t("a record longer than the buffer"));
+        const auto failed = writer.Failed();
+        writer.Write(tdata::int_t(1));
+        std::cout << failed << " " << writer.Flush() << " " << writer.Written() << std::endl;
+    }
+
+#ifdef TDATA_HAS_POSIX_IO
+    std::cout << "============================================" << std::endl;
+
+    char path[] = "/tmp/tdata_records_XXXXXX";
+    const int fd = mkstemp(path);
+    {
+        tdata::FdWriter writer(fd);
+        writer.Encode([&](tdata::ByteBuffer& b) { b.append(views.data(), views.size()); });
+    }
+    close(fd);
+    const tdata::str_t index_path = tdata::str_t(path) + ".idx";
+    for (int round = 0; round < 2; ++round)
+    {
+        tdata::RecordFile file;
+        const auto loaded = file.Open(path) && file.LoadIndex(index_path);
+        std::cout << std::boolalpha << loaded << " " << (loaded || file.Open(path, index_path)) << " " << file.Count();
+        tdata::TData data;
+        std::cout << " " << (file.Get(15, data) && data == vd_vi2) << " " << file.Record(file.Count() - 1) << " " << file.Record(file.Count()).empty();
+        tdata::str_t all;
+        file.ForEach([&](const tdata::TDataView& v) { all.append(v.GetText().data(), v.GetText().size()); });
+        std::cout << " " << (all == views) << std::endl;
+    }
+    {
+        // The records around an offset of a corrupt sidecar that runs past the data read as
+        // empty, the others still read; a rewrite of the data within the same second leaves
+        // the index stale; an index that cannot be saved is still used.
+        tdata::RecordFile file;
+        const auto opened = file.Open(path, index_path);
+        const uint64_t bogus = ~0ULL;
+        auto f = std::fopen(index_path.c_str(), "r+b");
+        std::fseek(f, 32 + sizeof(uint64_t), SEEK_SET);
+        std::fwrite(&bogus, sizeof(bogus), 1, f);
+        std::fclose(f);
+        tdata::TData got;
+        const auto corrupt = file.LoadIndex(index_path) && file.Record(0).empty() && file.Record(1).empty() && !file.Get(1, got) && !file.Record(2).empty();
+        std::remove(index_path.c_str());
+        const auto rebuilt = file.Open(path, index_path) && file.LoadIndex(index_path) && !file.Record(1).empty();
+        f = std::fopen(path, "wb");
+        std::fwrite(views.data(), 1, views.size(), f);
+        std::fclose(f);
+        const auto stale = file.Open(path) && file.LoadIndex(index_path);
+        const auto unsaved = file.Open(path, "/nonexistent/tdata.idx");
+        std::cout << opened << " " << corrupt << " " << rebuilt << " " << stale << " " << unsaved << " " << file.Count() << std::endl;
+    }
+    std::remove(path);
+    std::remove(index_path.c_str());
+#endif
+
+    std::cout << "============================================" << std::endl;
+
+    tdata::str_t many;
+    while (many.size() < 4 * tdata::Parallel::kMinChunk)
+    {
+        many += views;
+    }
+    std::vector<tdata::TData> seq, par;
+    for (const char* p = many.data(); p != many.data() + many.size(); )
+    {
+        seq.emplace_back();
+        p = tdata::TData::FromChars(seq.back(), p, many.data() + many.size());
+    }
+    for (unsigned threads = 1; threads <= 7; threads += 3)
+    {
+        std::cout << threads << " " << std::boolalpha << tdata::Parallel::Decode(many, par, threads) << " " << (par == seq) << std::endl;
+    }
+    many += "^x$";
+    std::cout << std::boolalpha << tdata::Parallel::Decode(many, par, 4) << " " << (par == seq) << std::endl;
+
+    tdata::str_t joined;
+    tdata::ByteBuffer joined_bytes;
+    tdata::Parallel::Encode(seq, joined, 5);
+    tdata::Parallel::Encode(seq, joined_bytes, 3);
+    std::cout << std::boolalpha << (joined == many.substr(0, many.size() - 3)) << " " << (joined_bytes.str() == joined) << std::endl;
+
+    // One pool serves batch after batch, with more chunks than threads.
+    {
+        tdata::WorkerPool pool(3);
+        std::vector<std::atomic<int>> hits(1000);
+        for (int round = 0; round < 10; ++round)
+        {
+            pool.Run(hits.size(), [&](std::size_t i) { ++hits[i]; });
+        }
+        bool same = true;
+        for (int round = 0; round < 5; ++round)
+        {
+            tdata::ByteBuffer bytes;
+            same = same && !tdata::Parallel::Decode(many, par, 7, &pool) && par == seq;
+            tdata::Parallel::Encode(seq, bytes, 5, &pool);
+            same = same && bytes.str() == joined;
+        }
+        std::cout << pool.Size() << " " << std::boolalpha << std::all_of(hits.begin(), hits.end(), [](const std::atomic<int>& h) { return 10 == h; }) << " "
+                  << same << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        tdata::Arena arena(256);
+        std::vector<tdata::TData> pooled(seq.size());
+        const char* p = joined.data();
+        for (auto& v : pooled)
+        {
+            p = tdata::TData::FromChars(v, p, joined.data() + joined.size(), &arena);
+        }
+        tdata::TData copy(pooled[19]);
+        tdata::TData moved(std::move(pooled[17]));
+        std::cout << std::boolalpha << (pooled[19] == seq[19]) << " " << (pooled[19].GetResource() == &arena) << " " << (copy == seq[19])
+                  << " " << (nullptr == copy.GetResource()) << " " << (moved == seq[17]) << " " << (moved.GetResource() == &arena) << " "
+                  << (arena.Allocated() > 0 && arena.Reserved() >= arena.Allocated()) << std::endl;
+        moved.SetValue(tdata::vreal_t{ 1, 2, 3, 4, 5, 6, 7, 8 });
+        std::cout << std::boolalpha << (moved.GetResource() == &arena) << " " << moved.ToStr() << std::endl;
+        pooled.clear();
+        moved.Clear();
+        arena.Reset();
+        std::cout << arena.Allocated() << std::endl;
+    }
+
+    {
+        tdata::TData reused;
+        tdata::TData::FromStr(reused, "^I6:1:2:3:4:5:6$");
+        const auto block = reused.GetValue<tdata::vint_t>().data();
+        const auto ok = tdata::TData::FromStr(reused, "^I5:7:8:9:10:11$");
+        std::cout << std::boolalpha << ok << " " << (reused.GetValue<tdata::vint_t>().data() == block) << " " << reused.ToStr() << " "
+                  << tdata::TData::FromStr(reused, "^I3:1:2$") << " " << reused.IsNull() << " " << (tdata::Type::kVInt == reused.GetType()) << " "
+                  << tdata::TData::FromStr(reused, "^s1$") << std::endl;
+
+        // Trailing bytes after the last element, or more elements than the count, are rejected.
+        tdata::TData junk;
+        std::cout << tdata::TData::FromStr(junk, "^I2:1:2junk$") << " " << tdata::TData::FromStr(junk, "^R1:0.5:1.5$") << " "
+                  << tdata::TData::FromStr(junk, "^S1:a:b$") << " " << tdata::TData::FromStr(junk, "^I0x$") << " " << tdata::TData::FromStr(junk, "^I2:1:2$") << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        tdata::StrPool pool;
+        const tdata::str_t host = "^sprod-db-0017.eu-west.example\\:5432$";
+        const tdata::str_t syms = "^S3:AAPL.XNAS:MSFT.XNAS:AAPL.XNAS$";
+        tdata::TData h1, h2, s1, s2;
+        tdata::TData::FromChars(h1, host.data(), host.data() + host.size(), pool);
+        tdata::TData::FromChars(h2, host.data(), host.data() + host.size(), pool);
+        tdata::TData::FromChars(s1, syms.data(), syms.data() + syms.size(), pool);
+        s2.SetValue(tdata::vstr_t{ "AAPL.XNAS", "MSFT.XNAS", "AAPL.XNAS" }, pool);
+        const auto e1 = s1.GetValue<tdata::vstr_t>();
+        const auto e2 = s2.GetValue<tdata::vstr_t>();
+        std::cout << std::boolalpha << (h1 == h2) << " " << (h1.GetValue<tdata::str_t>().data() == h2.GetValue<tdata::str_t>().data()) << " "
+                  << (h1.ToStr() == host) << " " << (s1 == s2) << " " << (e1[0].data() == e2[2].data()) << " " << (s1.ToStr() == syms) << " "
+                  << pool.Size() << std::endl;
+        tdata::TData copy(s1);
+        const auto pooled = e1[1].data();
+        s1.SetValue(tdata::vstr_t{ "x" });
+        // A pool only allocates when its Resource() is asked for by name.
+        tdata::TData h3;
+        h3.SetValue(tdata::str_t("prod-db-0017.eu-west.example:5432"), &pool.Resource());
+        std::cout << std::boolalpha << (copy == s2) << " " << (copy.GetValue<tdata::vstr_t>()[1].data() == pooled) << " " << s1.ToStr() << " "
+                  << std::is_convertible<tdata::StrPool*, tdata::MemoryResource*>::value << " " << (h3 == h1) << " "
+                  << (h3.GetValue<tdata::str_t>().data() == h1.GetValue<tdata::str_t>().data()) << " " << (h3.GetResource() == &pool.Resource()) << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        const std::hash<tdata::TData> hash;
+        const tdata::ExactEqual exact;
+        const tdata::TData zero(0.0), negzero(-0.0), nan1(std::nan("1")), nan2(std::nan("2")), tiny(1e-17);
+        std::cout << std::boolalpha << exact(zero, negzero) << " " << (hash(zero) == hash(negzero)) << " " << exact(nan1, nan2) << " "
+                  << (hash(nan1) == hash(nan2)) << " " << (zero == tiny) << " " << exact(zero, tiny) << std::endl;
+
+        tdata::vreal_t reals(1000);
+        for (std::size_t i = 0; i < reals.size(); ++i)
+        {
+            reals[i] = i * 0.25;
+        }
+        const tdata::TData built(reals);
+        tdata::TData decoded;
+        tdata::TData::FromStr(decoded, built.ToStr());
+        tdata::StrPool pool;
+        tdata::TData interned;
+        interned.SetValue(tdata::str_t("ticker-AAPL.XNAS.long.name"), pool);
+        std::cout << std::boolalpha << exact(built, decoded) << " " << (hash(built) == hash(decoded)) << " "
+                  << (hash(interned) == hash(tdata::TData(tdata::str_t("ticker-AAPL.XNAS.long.name")))) << " "
+                  << (hash(tdata::TData(1)) == hash(tdata::TData(1.0))) << std::endl;
+
+        std::unordered_map<tdata::TData, int, std::hash<tdata::TData>, tdata::ExactEqual> counts;
+        for (const auto& v : { tdata::TData(7), tdata::TData(-0.0), tdata::TData(0.0), built, decoded, interned, tdata::TData(tdata::vint_t{ 1, 2, 3 }),
+                               tdata::TData(tdata::vint_t{ 1, 2, 3 }), tdata::TData(tdata::vstr_t{ "a", "b" }), tdata::TData(tdata::vstr_t{ "ab" }) })
+        {
+            ++counts[v];
+        }
+        std::cout << counts.size() << " " << counts[tdata::TData(0.0)] << " " << counts[built] << " " << counts[tdata::TData(tdata::vint_t{ 1, 2, 3 })]
+                  << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        std::vector<tdata::TData> values;
+        values.emplace_back(tdata::vint_t{ 1, 2 });
+        values.emplace_back(std::nan(""));
+        values.emplace_back(tdata::str_t("b"));
+        values.emplace_back(3);
+        values.emplace_back(-1.5);
+        values.emplace_back(tdata::vint_t{ 1 });
+        values.emplace_back(tdata::str_t("a"));
+        values.emplace_back(-7);
+        values.emplace_back(tdata::vstr_t{ "x", "y" });
+        values.emplace_back(tdata::vreal_t{ 0.5 });
+        values.emplace_back(2.25);
+        values.emplace_back(tdata::vstr_t{ "x" });
+        auto sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        tdata::Sort(values);
+        bool same = true;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            same = same && tdata::ExactEqual()(values[i], sorted[i]);
+        }
+        for (const auto& v : values)
+        {
+            std::cout << v.ToStr();
+        }
+        std::cout << std::endl;
+
+        std::vector<tdata::TData> nums;
+        for (int i = 0; i < 1000; ++i)
+        {
+            nums.emplace_back(static_cast<tdata::int_t>((i * 7919) % 1000) - 500);
+        }
+        tdata::Sort(nums);
+        const auto it = std::lower_bound(nums.begin(), nums.end(), tdata::TData(42));
+        std::cout << std::boolalpha << same << " " << std::is_sorted(nums.begin(), nums.end()) << " " << it->ToStr() << " " << (it - nums.begin()) << " "
+                  << (tdata::TData(1) < tdata::TData(0.5)) << " " << (tdata::TData(-0.0) < tdata::TData(0.0)) << " "
+                  << (tdata::TData(1e300) < tdata::TData(std::nan(""))) << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        tdata::vint_t ints(1000);
+        tdata::vreal_t reals(1000);
+        for (std::size_t i = 0; i < ints.size(); ++i)
+        {
+            ints[i] = static_cast<tdata::int_t>(i * i);
+            reals[i] = 1e6 + i * 0.5;
+        }
+        const tdata::TData a(ints), r(reals);
+        ints[700] = -1;
+        reals[613] += 1e-4;
+        const tdata::TData b(ints), s(reals), prefix(tdata::vint_t(ints.begin(), ints.begin() + 300));
+        std::cout << tdata::FindMismatch(a, b) << " " << tdata::FindMismatch(a, prefix) << " " << tdata::FindMismatch(r, s) << " "
+                  << tdata::FindMismatch(tdata::TData(tdata::vstr_t{ "a", "bc", "d" }), tdata::TData(tdata::vstr_t{ "a", "bd", "d" })) << " "
+                  << tdata::FindMismatch(a, tdata::TData(1)) << std::endl;
+        const tdata::TData one(1.0), next(std::nextafter(1.0, 2.0)), nan(std::nan(""));
+        std::cout << std::boolalpha << (tdata::kNoMismatch == tdata::FindMismatch(a, tdata::TData(a))) << " " << (r == s) << " "
+                  << tdata::Equal(r, s, tdata::Tolerance::Relative(1e-9)) << " " << tdata::Equal(r, s, tdata::Tolerance::Absolute(1e-3)) << " "
+                  << tdata::Equal(one, next, tdata::Tolerance::Ulps(1)) << " " << tdata::Equal(one, next, tdata::Tolerance::Ulps(0)) << " "
+                  << tdata::Equal(nan, nan, tdata::Tolerance::Ulps(10)) << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        struct Describe
+        {
+            tdata::str_t operator()(tdata::int_t v) const { return "int " + std::to_string(v); }
+            tdata::str_t operator()(tdata::real_t v) const { return "real " + std::to_string(v); }
+            tdata::str_t operator()(tdata::StrView v) const { return "str " + v.str(); }
+            tdata::str_t operator()(tdata::Span<tdata::int_t> v) const { return "vint of " + std::to_string(v.size()); }
+            tdata::str_t operator()(tdata::Span<tdata::real_t> v) const { return "vreal of " + std::to_string(v.size()); }
+            tdata::str_t operator()(tdata::Span<tdata::StrView> v) const { return "vstr of " + std::to_string(v.size()); }
+        };
+        const tdata::TData values[] = { tdata::TData(4), tdata::TData(0.5), tdata::TData(tdata::str_t("hi")), tdata::TData(tdata::vint_t{ 1, 2 }),
+                                        tdata::TData(tdata::vreal_t{ 1 }), tdata::TData(tdata::vstr_t{ "a", "b", "c" }), tdata::TData() };
+        for (const auto& v : values)
+        {
+            std::cout << "[" << v.Visit(Describe()) << "]";
+        }
+        std::cout << std::endl;
+
+        const tdata::variant_t variants[] = { tdata::int_t(4), tdata::str_t("hi"), tdata::vstr_t{ "a", "b" } };
+        for (const auto& v : variants)
+        {
+            tdata::variant_t copy(v);
+            std::cout << copy.which() << ":" << (copy == v) << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        const tdata::Schema schema{ tdata::Type::kInt, tdata::Type::kReal, tdata::Type::kStr, tdata::Type::kVInt, tdata::Type::kVReal, tdata::Type::kVStr };
+        tdata::TRecord row(schema);
+        std::cout << std::boolalpha << schema.IsValid() << " " << row.ToStr() << std::endl;
+        row.Set(0, 42);
+        row.Set(1, 2.5);
+        row.Set(2, tdata::str_t("AAPL:XNAS"));
+        row.Set(3, tdata::vint_t{ 1, 2, 3, 4, 5, 6 });
+        row.Set(4, tdata::vreal_t{ 0.5 });
+        row.Set(5, tdata::vstr_t{ "bid", "ask" });
+        const auto wrong = row.Set(0, tdata::str_t("x"));
+        const auto text = row.ToStr();
+        std::cout << wrong << " " << text << std::endl;
+
+        tdata::TRecord decoded(schema), binary(schema);
+        tdata::str_t::size_type pos = 0;
+        const auto twice = text + text;
+        const auto ok = tdata::TRecord::FromStr(decoded, twice, &pos);
+        const auto block = decoded[3].GetValue<tdata::vint_t>().data();
+        const auto again = tdata::TRecord::FromStr(decoded, twice, &pos);
+        const auto bin = row.ToBinary();
+        std::cout << ok << " " << again << " " << (pos == twice.size()) << " " << (decoded == row) << " " << (decoded[3].GetValue<tdata::vint_t>().data() == block)
+                  << " " << tdata::TRecord::FromBinary(binary, bin) << " " << (binary == row) << " " << (bin == decoded.ToBinary()) << std::endl;
+
+        const tdata::str_t swapped = "^i1$^s2.5$^sx$^I0$^R0$^S0$";
+        const tdata::str_t cut = text.substr(0, text.size() - 1);
+        const tdata::str_t truncated = "^i1$^r2.5$";
+        std::cout << tdata::TRecord::FromStr(decoded, swapped) << " " << tdata::TRecord::FromStr(decoded, cut) << " " << tdata::TRecord::FromStr(decoded, truncated)
+                  << " " << tdata::Schema{ tdata::Type::kInt, tdata::Type::kUnknown }.IsValid() << std::endl;
+
+        // Values must match the schema's type, and a row of an invalid schema writes nothing.
+        const tdata::Schema invalid{ tdata::Type::kInt, tdata::Type::kUnknown };
+        tdata::TRecord odd(invalid);
+        // A numeric field with trailing bytes fails the row at that field.
+        const tdata::Schema numbers{ tdata::Type::kInt, tdata::Type::kReal };
+        tdata::TRecord pair(numbers);
+        std::cout << tdata::TRecord::FromStr(pair, "^i1x$^r2$") << " " << tdata::TRecord::FromStr(pair, "^i1$^r2y$") << " " << tdata::TRecord::FromStr(pair, "^i1x$^r2y$")
+                  << " " << tdata::TRecord::FromStr(pair, "^i$^r2$") << " " << tdata::TRecord::FromStr(pair, "^i1$^r2$") << " " << pair.ToStr() << std::endl;
+        std::cout << row.Set(1, tdata::int_t(3)) << " " << odd.Set(0, 7) << " " << odd.Set(1, tdata::str_t("x")) << " " << odd.Set(1, 7) << " "
+                  << odd.ToStr().empty() << " " << odd.ToBinary().empty() << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        const Quote q{ "AAPL:XNAS", -300, 189.25, 189.5f, true, { 7, 8 }, { 0.5, 1.5 }, { "bid", "ask" } };
+        const auto text = tdata::StructCoder::ToStr(q);
+        const auto bin = tdata::StructCoder::ToBinary(q);
+        std::cout << text << std::endl;
+
+        // The bytes of each member boxed in a TData, and of the same row in a TRecord.
+        tdata::str_t boxed, boxed_bin;
+        for (const auto& v : { tdata::TData(q.sym), tdata::TData(q.size), tdata::TData(q.bid), tdata::TData(q.ask), tdata::TData(q.live),
+                               tdata::TData(q.ids), tdata::TData(q.levels), tdata::TData(q.venues) })
+        {
+            v.ToStr(boxed);
+            v.ToBinary(boxed_bin);
+        }
+        const tdata::Schema schema{ tdata::Type::kStr, tdata::Type::kInt, tdata::Type::kReal, tdata::Type::kReal, tdata::Type::kInt,
+                                    tdata::Type::kVInt, tdata::Type::kVReal, tdata::Type::kVStr };
+        tdata::TRecord row(schema);
+        std::cout << std::boolalpha << (text == boxed) << " " << (bin == boxed_bin) << " " << tdata::TRecord::FromStr(row, text) << " " << (row.ToBinary() == bin) << std::endl;
+
+        Quote out{}, out_bin{};
+        tdata::str_t::size_type pos = 0;
+        const auto twice = text + text;
+        const auto ok = tdata::StructCoder::FromStr(out, twice, &pos);
+        const auto again = tdata::StructCoder::FromStr(out, twice, &pos);
+        std::cout << ok << " " << again << " " << (pos == twice.size()) << " " << tdata::StructCoder::FromBinary(out_bin, bin) << " "
+                  << (tdata::StructCoder::ToStr(out) == text) << " " << (tdata::StructCoder::ToBinary(out_bin) == bin) << " " << out.size << " " << out.ask << " " << out.live << std::endl;
+
+        const tdata::str_t swapped = "^i1$^i2$^r3$^r4$^i1$^I0$^R0$^S0$";
+        const tdata::str_t truncated = text.substr(0, text.size() - 1);
+        std::cout << tdata::StructCoder::FromStr(out, swapped) << " " << tdata::StructCoder::FromStr(out, truncated) << " " << tdata::StructCoder::FromBinary(out, bin.substr(1)) << std::endl;
+
+        // Hostile element counts fail as they do for TData, without reserving anything.
+        const tdata::str_t head = "^sX$^i1$^r1$^r1$^i1$";
+        for (const auto bad : { "^I-1:1$", "^I99999999999999999:1$", "^I3:1:2$", "^I1:1:2$", "^I2:1:2x$" })
+        {
+            tdata::TData boxed_v;
+            tdata::vint_t ids;
+            std::cout << tdata::StructCoder::FromStr(out, head + bad + "^R0$^S0$") << tdata::TData::FromStr(boxed_v, bad) << tdata::tdata_traits<tdata::vint_t>::FromStr(ids, bad) << " ";
+        }
+        tdata::vreal_t reals;
+        tdata::vstr_t strs;
+        std::cout << tdata::tdata_traits<tdata::vreal_t>::FromStr(reals, "^R-2:1$") << " " << tdata::tdata_traits<tdata::vstr_t>::FromStr(strs, "^S99999999999999999:a$") << " "
+                  << tdata::tdata_traits<tdata::vstr_t>::FromStr(strs, "^S2::$") << " " << strs.size() << std::endl;
+
+        // Numbers out of the range of a narrower member are rejected rather than truncated.
+        const tdata::str_t tail = "^I0$^R0$^S0$";
+        std::cout << tdata::StructCoder::FromStr(out, "^sX$^i99999999999$^r1$^r1$^i1$" + tail) << " " << tdata::StructCoder::FromStr(out, "^sX$^i1$^r1$^r1e300$^i1$" + tail) << " "
+                  << tdata::StructCoder::FromStr(out, "^sX$^i1$^r1$^r1$^i2$" + tail) << " " << tdata::StructCoder::FromStr(out, "^sX$^i-2147483648$^r1$^rinf$^i0$" + tail) << " "
+                  << out.size << " " << out.ask << " " << out.live << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        // One header word and TDATA_INLINE_WORDS payload words. Copies and moves between inline
+        // and heap values of every type, both ways, keep the value and leave the source usable;
+        // self-assignment is a no-op.
+        const tdata::str_t long_str(100, 'x');
+        const tdata::TData values[] = { tdata::TData(tdata::int_t(-5)), tdata::TData(2.5), tdata::TData(tdata::str_t("ab")), tdata::TData(long_str),
+                                        tdata::TData(tdata::vint_t{ 1 }), tdata::TData(tdata::vint_t(50, 7)), tdata::TData(tdata::vreal_t{ 0.5 }),
+                                        tdata::TData(tdata::vreal_t(50, 0.5)), tdata::TData(tdata::vstr_t{ "a" }), tdata::TData(tdata::vstr_t(20, long_str)) };
+        bool copies = true, moves = true, selves = true;
+        for (const auto& from : values)
+        {
+            for (const auto& to : values)
+            {
+                tdata::TData copy(to);
+                copy = from;
+                copies = copies && tdata::ExactEqual()(copy, from) && tdata::ExactEqual()(tdata::TData(copy), from);
+
+                tdata::TData moved(to), source(from);
+                moved = std::move(source);
+                tdata::TData constructed(std::move(moved));
+                source = to;
+                moves = moves && tdata::ExactEqual()(constructed, from) && tdata::ExactEqual()(source, to);
+            }
+            tdata::TData self(from);
+            auto& alias = self;
+            self = alias;
+            selves = selves && tdata::ExactEqual()(self, from);
+            self = std::move(alias);
+            selves = selves && tdata::ExactEqual()(self, from);
+        }
+        std::cout << std::boolalpha << (sizeof(tdata::TData) == 8 + 8 * TDATA_INLINE_WORDS) << " " << copies << " " << moves << " " << selves << std::endl;
+    }
+
+    {
+        // Strings of up to 5 + 8 * TDATA_INLINE_WORDS chars and numeric vectors of up to
+        // TDATA_INLINE_WORDS elements live inside the object, set or decoded; one more goes to
+        // the heap. Assigning across the boundary either way keeps the value.
+        const std::size_t chars = 5 + 8 * TDATA_INLINE_WORDS, words = TDATA_INLINE_WORDS;
+        const auto inside = [](const tdata::TData& v, const void* p) {
+            return static_cast<const char*>(p) >= reinterpret_cast<const char*>(&v) && static_cast<const char*>(p) < reinterpret_cast<const char*>(&v + 1);
+        };
+        const tdata::TData values[] = { tdata::TData(tdata::str_t(chars, 'a')), tdata::TData(tdata::str_t(chars + 1, 'a')),
+                                        tdata::TData(tdata::vint_t(words, 3)), tdata::TData(tdata::vint_t(words + 1, 3)),
+                                        tdata::TData(tdata::vreal_t(words, 0.5)), tdata::TData(tdata::vreal_t(words + 1, 0.5)) };
+        for (const auto& v : values)
+        {
+            tdata::TData decoded;
+            tdata::TData::FromStr(decoded, v.ToStr());
+            const void* p = nullptr;
+            const void* q = nullptr;
+            switch (v.GetType())
+            {
+            case tdata::Type::kStr: p = v.GetValue<tdata::str_t>().data(); q = decoded.GetValue<tdata::str_t>().data(); break;
+            case tdata::Type::kVInt: p = v.GetValue<tdata::vint_t>().data(); q = decoded.GetValue<tdata::vint_t>().data(); break;
+            default: p = v.GetValue<tdata::vreal_t>().data(); q = decoded.GetValue<tdata::vreal_t>().data(); break;
+            }
+            std::cout << inside(v, p) << inside(decoded, q) << " ";
+        }
+        bool crossed = true;
+        for (std::size_t i = 0; i < 6; i += 2)
+        {
+            tdata::TData v(values[i]);
+            v = values[i + 1];
+            crossed = crossed && tdata::ExactEqual()(v, values[i + 1]);
+            v = values[i];
+            crossed = crossed && tdata::ExactEqual()(v, values[i]);
+            crossed = crossed && tdata::TData::FromStr(v, values[i + 1].ToStr()) && tdata::ExactEqual()(v, values[i + 1]);
+            crossed = crossed && tdata::TData::FromStr(v, values[i].ToStr()) && tdata::ExactEqual()(v, values[i]);
+        }
+        std::cout << crossed << std::endl;
+    }
+
+    std::cout << "============================================" << std::endl;
+
+    {
+        // Shortest round-trip formatting at the edges of double: signed zero, the smallest
+        // denormal and normal, the largest finite, large exponents, infinities and NaN.
+        const auto inf = std::numeric_limits<tdata::real_t>::infinity();
+        for (const auto r : { 0.1, -0.0, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 1e21, 1.2345678901234568e17, 1e-7, inf, -inf,
+                              std::numeric_limits<tdata::real_t>::quiet_NaN() })
+        {
+            const tdata::TData v(r);
+            tdata::TData back;
+            std::cout << v.ToStr() << (tdata::TData::FromStr(back, v.ToStr()) && tdata::ExactEqual()(back, v) ? " " : "! ");
+        }
+        std::cout << std::endl;
+    }
+
+    {
+        // int64 bounds, out of range values saturating like strtoll, an explicit '+', vectors
+        // at both bounds, and records cut before their '$'.
+        for (const auto text : { "^i9223372036854775807$", "^i-9223372036854775808$", "^i9223372036854775808$", "^i-9223372036854775809$", "^i+5$",
+                                 "^I2:-9223372036854775808:9223372036854775807$", "^i12", "^I2:1:2", "^I2:1:" })
+        {
+            tdata::TData v;
+            std::cout << (tdata::TData::FromStr(v, text) ? v.ToStr() : "fail") << " ";
+        }
+        std::cout << std::endl;
+        // A payload that is empty, a bare sign or a number with trailing bytes is not an int,
+        // whether decoded alone, as a vector element or through the typed decoders.
+        for (const auto text : { "^i$", "^i-$", "^i12x$", "^iabc$", "^i1 $", "^I2:1:$", "^I2::2$", "^I1:-$" })
+        {
+            tdata::TData v;
+            tdata::int_t i = 0;
+            tdata::vint_t vi;
+            std::cout << tdata::TData::FromStr(v, text) << tdata::tdata_traits<tdata::int_t>::FromStr(i, text) << tdata::tdata_traits<tdata::vint_t>::FromStr(vi, text)
+                      << (nullptr != tdata::TData::FromCharsAs<tdata::Type::kInt>(v, text, text + std::strlen(text), nullptr)) << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    {
+        // Spelled-out infinities and NaN, denormals, overflow to inf and underflow to 0, a
+        // value next to the smallest normal that is hard to round, and records cut short.
+        for (const auto text : { "^rinf$", "^r-infinity$", "^rNaN$", "^r1e-320$", "^r4.9e-324$", "^r1e400$", "^r1e-400$", "^r.5$",
+                                 "^R3:inf:-inf:nan$", "^r1.5", "^R2:1.5:" })
+        {
+            tdata::TData v;
+            std::cout << (tdata::TData::FromStr(v, text) ? v.ToStr() : "fail") << " ";
+        }
+        tdata::real_t hard = 0, denormal = 0;
+        tdata::tdata_traits<tdata::real_t>::FromStr(hard, "^r2.2250738585072011e-308$");
+        tdata::tdata_traits<tdata::real_t>::FromStr(denormal, "^r1e-320$");
+        std::cout << (hard == 2.2250738585072011e-308) << " " << (denormal == 1e-320) << std::endl;
+        // Nothing but one number may stand between the tag and the '$'.
+        for (const auto text : { "^r$", "^r1.5x$", "^rnanx$", "^r1.5zz$", "^r-$", "^re5$", "^R2:1.5:$", "^R1:infx$" })
+        {
+            tdata::TData v;
+            tdata::real_t r = 0;
+            tdata::vreal_t vr;
+            std::cout << tdata::TData::FromStr(v, text) << tdata::tdata_traits<tdata::real_t>::FromStr(r, text) << tdata::tdata_traits<tdata::vreal_t>::FromStr(vr, text)
+                      << (nullptr != tdata::TData::FromCharsAs<tdata::Type::kReal>(v, text, text + std::strlen(text), nullptr)) << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    {
+        // Escapes in kStr and kVStr, empty vectors and empty elements, a string whose specials
+        // sit at and across the blocks of the bulk scan, and a record whose only '$' is escaped.
+        for (const auto text : { R"K(^sa\:b\\c\$d$)K", R"K(^S2:\::\$$)K", "^I0$", "^R0$", "^S0$", "^S3:::$", R"K(^sabc\$)K" })
+        {
+            tdata::TData v;
+            std::cout << (tdata::TData::FromStr(v, text) ? v.ToStr() : "fail") << " ";
+        }
+        tdata::str_t wide(100, 'x');
+        for (const auto i : { 0, 15, 16, 31, 32, 47, 63, 64, 99 })
+        {
+            wide[i] = ":$\\"[i % 3];
+        }
+        tdata::TData v(wide), back;
+        std::cout << (tdata::TData::FromStr(back, v.ToStr()) && back == v) << " " << v.ToStr().size() << std::endl;
+    }
+
     return 0;
 }
-